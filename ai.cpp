@@ -1,277 +1,1042 @@
 #include "ai.h"
+#include "patterns.h"
+#include "strategy.h"
+#include "trace.h"
 #include <utility>
 #include <algorithm>
+#include <array>
+#include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
-#include <cassert>
+#include <mutex>
+#include <random>
+#include <stdexcept>
 
 using namespace minesweeper;
 
-MineAI::MineAI(std::shared_ptr<Board> board)
-    : board(std::move(board))
+MineAI::MineAI(const Board& board)
+    : state(board)
 {
 }
 
+MineAI::MineAI(const SolverState& knowledge)
+    : state(knowledge)
+{
+}
+
+MineAI MineAI::player(Board& board)
+{
+    MineAI ai(board);
+    ai.playing = &board;
+    return ai;
+}
+
 std::optional<int>
 MineAI::open_any()
 {
-    auto cells = board->get_total_cells();
+    if (playing == nullptr) {
+        return std::optional<int>();
+    }
+    auto cells = state.total_cells();
     for (auto i = 0; i < cells; i++) {
-        if ((*board)[i].closed()) {
+        if (state.is_unknown(i)) {
             if (log_enabled) {
                 std::cout << "RANDOM Open cell " << i << std::endl;
             }
-            board->open_cell(i);
+            playing->open_cell(i);
+            state.sync_opened(playing->last_revealed());
             return i;
         }
     }
     return std::optional<int>();
 }
 
-bool MineAI::solve_all(std::shared_ptr<Board> board, bool logging, AICallback& cb)
+SolveResult MineAI::solve_all(const Board& board, bool logging, AICallback& cb)
 {
-    return solve_all(std::move(board), logging, cb, 0);
+    MineAI ai(board);
+    ai.logging() = logging;
+    return ai.run(cb);
 }
 
-bool MineAI::solve_all(std::shared_ptr<Board> board,
-    bool logging,
-    AICallback& cb,
-    int nest_level)
+SolveResult MineAI::play_all(Board& board, bool logging, AICallback& cb, bool per_step)
 {
-    auto ai = std::make_unique<MineAI>(board);
-    ai->assume_nest_level = nest_level;
-    if (nest_level > 0) {
-        ai->firsttime = false;
-    }
-    ai->logging() = logging;
-    cb.before_start(board);
-    int step = 0;
-    while (true) {
-        if (board->cleared()) {
-            return true;
-        } else if (board->failed()) {
-            return false;
+    auto ai = MineAI::player(board);
+    ai.logging() = logging;
+    ai.per_step_callbacks() = per_step;
+    return ai.run(cb);
+}
+
+SolveResult MineAI::run(AICallback& cb)
+{
+    cb.before_start(state);
+    const auto steps = [&] {
+        int step = 0;
+        while (true) {
+            if (state.solved()) {
+                return SolveResult::Solved;
+            } else if (playing != nullptr && playing->failed()) {
+                return SolveResult::Stopped;
+            }
+            const auto result = next_step(cb);
+            if (result != Step::Progress && cb.cancelled()) {
+                return SolveResult::Stopped;
+            }
+            if (result != Step::Progress) {
+                if (log_enabled) {
+                    std::cerr << (result == Step::Stuck ? "NO LOGIC" : "CONTRADICTION") << std::endl;
+                    state.board().show_game_state(std::cerr, true);
+                    std::cerr << std::endl;
+                }
+                return result == Step::Stuck ? SolveResult::Stuck : SolveResult::Contradiction;
+            }
+            if (!cb.on_step(state, step++, assume_nest_level)) {
+                return SolveResult::Stopped;
+            }
         }
-        ai->next_step(logging, cb);
-        if (!cb.on_step(board, step++, ai->assume_nest_level)) {
-            return false;
+    };
+    const auto result = steps();
+    cb.on_finish(state, counters);
+    return result;
+}
+
+void MineAI::mines_moved(const std::vector<int>& cells)
+{
+    for (auto index : cells) {
+        state.mine_moved(index);
+    }
+    // its clauses encode the old numbers.
+    sat.reset();
+}
+
+void MineAI::resolve_safe(int index, Rule rule)
+{
+    counters.deductions_by(rule)++;
+    SOLVER_TRACE(Deduction, index, assume_nest_level, 0);
+    if (state.speculating()) {
+        state.mark_safe(index);
+    } else if (playing != nullptr) {
+        if (playing->flagged().test(index)) {
+            playing->toggle_flag(index);
         }
+        playing->open_cell(index);
+        state.sync_opened(playing->last_revealed());
+    } else {
+        state.reveal(index);
     }
 }
 
-void erase_assumption(const Board& base, Board& erased)
+void MineAI::resolve_mine(int index, Rule rule)
 {
-    assert(base.width() == erased.width());
-    assert(base.height() == erased.height());
-    const int cells = base.get_total_cells();
+    counters.deductions_by(rule)++;
+    SOLVER_TRACE(Deduction, index, assume_nest_level, 1);
+    state.mark_mine(index);
+    if (!state.speculating() && playing != nullptr && !playing->flagged().test(index)) {
+        playing->toggle_flag(index);
+    }
+}
 
-    for (int i = 0; i < cells; i++) {
-        if (!base[i].is_assumption() && erased[i].is_assumption()) {
-            erased[i].is_assumption() = false;
-        }
+Step MineAI::contradiction(const char* reason) const
+{
+    if (log_enabled) {
+        std::cout << reason << std::endl;
     }
+    return Step::Contradiction;
 }
 
-void MineAI::next_step(bool logging, AICallback& cb)
+// runs the rules on top of the current assumption until they stop making
+// progress or find a contradiction.
+Step MineAI::speculate(AICallback& cb)
 {
-    const auto in_assumption = assume_nest_level > 0;
+    struct NestGuard {
+        int& level;
+        ~NestGuard() { level--; }
+    } guard { ++assume_nest_level };
+    counters.max_depth = std::max(counters.max_depth, assume_nest_level);
 
-    // 最初からマスが開いてる場合にバグる
-    //    if (firsttime) {
-    //        firsttime = false;
-    //        open_any();
-    //        return;
-    //    }
+    int step = 0;
+    while (!state.solved()) {
+        const auto result = next_step(cb);
+        if (result != Step::Progress) {
+            return result;
+        }
+        if (!cb.on_step(state, step++, assume_nest_level)) {
+            break;
+        }
+    }
+    return Step::Stuck;
+}
 
-    auto cells = board->get_total_cells();
-    bool ok = false;
-    for (auto i = 0; i < cells; i++) {
-        const auto& cell = (*board)[i];
+Step MineAI::propagate(int max_deductions)
+{
+    const auto& board = state.board();
+    int resolved = 0;
+    int deductions = 0;
+    // only cells whose neighborhood changed can yield something new.
+    int i;
+    while (deductions != max_deductions && state.pop_pending(i)) {
+        // we can solve puzzle by utilizing neighbor bomb cell hints.
+        const auto bombs_around = state.number(i);
+        const auto unknown_cells_around = state.unknown_around(i);
+        const auto mine_cells_around = state.mines_around(i);
 
-        // skip flagged cells.
-        if (cell.flagged()) {
-            continue;
+        if (bombs_around < mine_cells_around) {
+            return contradiction("bombs_around < mine_cells_around");
+        } else if (bombs_around > mine_cells_around + unknown_cells_around) {
+            return contradiction("bombs_around > mine_cells_around + unknown_cells_around");
         }
 
-        // we cannot get any information from closed cells.
-        if (cell.closed()) {
+        if (unknown_cells_around == 0) {
             continue;
         }
 
-        // we can solve puzzle by utilizing neighbor bomb cell hints.
-        if (cell.opened() && !cell.is_assumption()) {
-            auto bombs_around = cell.neighbor_bombs();
-
-            std::vector<std::pair<Cell*, int>> neighbors;
-            for (auto dir : ALL_DIRECTIONS) {
-                auto index = board->get_cell_index(i, dir);
-                if (index.has_value()) {
-                    neighbors.push_back(std::make_pair(&(*board)[index.value()], index.value()));
+        if (bombs_around == mine_cells_around) {
+            // open all remaining cells.
+            if (log_enabled) {
+                std::cout << "Open cells around " << i << " by logic." << std::endl;
+            }
+            for (const auto c : board.neighbors(i)) {
+                if (state.is_unknown(c)) {
+                    resolve_safe(c, Rule::SingleCell);
+                    resolved++;
                 }
             }
-            int closed_cells_around = 0;
-            int flagged_cells_around = 0;
-            for (const auto neighbor : neighbors) {
-                switch (neighbor.first->state()) {
-                case CellState::Closed:
-                    closed_cells_around++;
-                    break;
-                case CellState::Flagged:
-                    flagged_cells_around++;
-                    break;
-                default:
-                    break;
+            deductions++;
+        } else if (bombs_around == mine_cells_around + unknown_cells_around) {
+            // flag all remaining cells.
+            if (log_enabled) {
+                std::cout << "Flag cells around " << i << " by logic." << std::endl;
+            }
+            for (const auto c : board.neighbors(i)) {
+                if (state.is_unknown(c)) {
+                    resolve_mine(c, Rule::SingleCell);
+                    resolved++;
+                }
+            }
+            deductions++;
+        }
+    }
+
+    if (!state.consistent()) {
+        return contradiction("more cells known than the mine count allows");
+    }
+    return resolved > 0 ? Step::Progress : Step::Stuck;
+}
+
+Step MineAI::pattern_deduce()
+{
+    using namespace patterns;
+    const auto& board = state.board();
+    const auto width = board.width();
+    const auto height = board.height();
+    int resolved = 0;
+
+    // the frontier changes as cells are resolved, so walk a copy of it.
+    const auto frontier = state.frontier();
+    for (auto w = 0; w < frontier.word_count() && !(per_step && resolved > 0); w++) {
+        for (auto bits = frontier.word(w); bits != 0; bits &= bits - 1) {
+            const auto a = w * BitPlane::WORD_BITS + lowest_bit(bits);
+            if (!state.frontier().test(a)) {
+                continue;
+            }
+            const auto point = board.from_index(a);
+
+            std::uint32_t window = 0;
+            for (auto k = 0; k < 8; k++) {
+                const auto column = point.first + NEIGHBORS[k].dx;
+                const auto row = point.second + NEIGHBORS[k].dy;
+                if (column >= 0 && column < width && row >= 0 && row < height && state.is_unknown(board.from_point(column, row))) {
+                    window |= 1u << k;
                 }
             }
 
-            if (bombs_around == flagged_cells_around) {
-                if (closed_cells_around > 0) {
-                    // open all remaining cells.
-                    if (log_enabled) {
-                        std::cout << "Open cells around " << i << " by logic." << std::endl;
+            for (const auto& partner : PARTNERS) {
+                const auto column = point.first + partner.dx;
+                const auto row = point.second + partner.dy;
+                if (column < 0 || column >= width || row < 0 || row >= height) {
+                    continue;
+                }
+                const auto b = board.from_point(column, row);
+                const auto shared = bit_count(window & partner.shared);
+                if (shared == 0 || !state.frontier().test(b)) {
+                    continue;
+                }
+                const auto need_a = state.number(a) - state.mines_around(a);
+                const auto need_b = state.number(b) - state.mines_around(b);
+                if (need_a < 0 || need_b < 0) {
+                    return contradiction("bombs_around < mine_cells_around");
+                }
+                const auto code = RULES[rule_index(state.unknown_around(a) - shared, shared,
+                    state.unknown_around(b) - shared, need_a, need_b)];
+                if (code == 0) {
+                    continue;
+                }
+                if (code & CONTRADICTION) {
+                    return contradiction("two numbers cannot both be satisfied");
+                }
+
+                if (log_enabled) {
+                    std::cout << "Resolve cells around " << a << " and " << b << " by pattern." << std::endl;
+                }
+                const auto sees_a = [&](int cell) {
+                    const auto p = board.from_index(cell);
+                    return std::abs(p.first - point.first) <= 1 && std::abs(p.second - point.second) <= 1;
+                };
+                const auto sees_b = [&](int cell) {
+                    const auto p = board.from_index(cell);
+                    return std::abs(p.first - column) <= 1 && std::abs(p.second - row) <= 1;
+                };
+                // decide every cell before resolving any, as resolving moves the counts.
+                std::array<int, 16> mines;
+                std::array<int, 16> safes;
+                int mine_count = 0;
+                int safe_count = 0;
+                const auto decide = [&](int cell, std::uint8_t mine, std::uint8_t safe) {
+                    if (code & mine) {
+                        mines[mine_count++] = cell;
+                    } else if (code & safe) {
+                        safes[safe_count++] = cell;
                     }
-                    for (const auto c : neighbors) {
-                        if (c.first->closed()) {
-                            if (!in_assumption) {
-                                board->open_cell(c.second);
-                            } else {
-                                c.first->state() = CellState::Opened;
-                                c.first->is_assumption() = true;
-                            }
+                };
+                for (auto cell : board.neighbors(a)) {
+                    if (state.is_unknown(cell)) {
+                        if (sees_b(cell)) {
+                            decide(cell, SHARED_MINE, SHARED_SAFE);
+                        } else {
+                            decide(cell, A_MINE, A_SAFE);
                         }
                     }
-                    ok = true;
-                    break;
-                } else {
-                    continue;
                 }
-            } else if (bombs_around > flagged_cells_around) {
-                if (closed_cells_around == bombs_around - flagged_cells_around) {
-                    // flag all remaining cells.
-                    if (log_enabled) {
-                        std::cout << "Flag cells around " << i << " by logic." << std::endl;
+                for (auto cell : board.neighbors(b)) {
+                    if (state.is_unknown(cell) && !sees_a(cell)) {
+                        decide(cell, B_MINE, B_SAFE);
                     }
-                    for (const auto c : neighbors) {
-                        if (c.first->closed()) {
-                            c.first->state() = CellState::Flagged;
-                            c.first->is_assumption() = in_assumption;
-                        }
+                }
+                for (auto i = 0; i < mine_count; i++) {
+                    resolve_mine(mines[i], Rule::Pattern);
+                }
+                for (auto i = 0; i < safe_count; i++) {
+                    if (state.is_unknown(safes[i])) {
+                        resolve_safe(safes[i], Rule::Pattern);
                     }
-                    ok = true;
-                    break;
-                } else {
-                    continue;
                 }
-            } else {
-                throw AIReasoningError("bombs_around < flagged_cells_around");
+                resolved += mine_count + safe_count;
+                // a's window is stale now.
+                break;
+            }
+            if (per_step && resolved > 0) {
+                break;
             }
         }
     }
 
-    if (ok) {
+    if (!state.consistent()) {
+        return contradiction("more cells known than the mine count allows");
+    }
+    return resolved > 0 ? Step::Progress : Step::Stuck;
+}
+
+Step MineAI::linear_deduce()
+{
+    const auto result = eliminator.run(state);
+    if (result.contradiction) {
+        return contradiction("the frontier equations have no solution");
+    }
+
+    int resolved = 0;
+    for (auto i : result.mines) {
+        if (state.is_unknown(i)) {
+            resolve_mine(i, Rule::Linear);
+            resolved++;
+        }
+    }
+    for (auto i : result.safe) {
+        if (state.is_unknown(i)) {
+            resolve_safe(i, Rule::Linear);
+            resolved++;
+        }
+    }
+    if (resolved > 0 && log_enabled) {
+        std::cout << "Resolve " << resolved << " cells by row reduction of "
+                  << result.equations << " equations." << std::endl;
+    }
+    if (!state.consistent()) {
+        return contradiction("more cells known than the mine count allows");
+    }
+    return resolved > 0 ? Step::Progress : Step::Stuck;
+}
+
+Step MineAI::enumerate_deduce(EnumerationResult& result)
+{
+    result = enumerator.run(state);
+    if (result.contradiction) {
+        return contradiction("no mine configuration fits the numbers");
+    }
+
+    int resolved = 0;
+    for (auto i : result.mines) {
+        if (state.is_unknown(i)) {
+            resolve_mine(i, Rule::Enumeration);
+            resolved++;
+        }
+    }
+    for (auto i : result.safe) {
+        // an earlier cell may have opened it already.
+        if (state.is_unknown(i)) {
+            resolve_safe(i, Rule::Enumeration);
+            resolved++;
+        }
+    }
+    if (resolved > 0 && log_enabled) {
+        std::cout << "Resolve " << resolved << " cells by enumerating "
+                  << result.components << " components" << (result.endgame ? " in the endgame." : ".") << std::endl;
+    }
+    if (!state.consistent()) {
+        return contradiction("more cells known than the mine count allows");
+    }
+    return resolved > 0 ? Step::Progress : Step::Stuck;
+}
+
+std::vector<double> MineAI::mine_probabilities() const
+{
+    return enumerator.run(state).probability;
+}
+
+namespace {
+// at most k of literals are true, as a sequential counter (Sinz 2005):
+// O(n k) clauses and auxiliary vars instead of one clause per subset.
+void add_at_most(SatSolver& sat, const std::vector<SatSolver::Literal>& literals, int k)
+{
+    const auto n = static_cast<int>(literals.size());
+    if (k >= n) {
+        return;
+    }
+    if (k <= 0) {
+        for (auto literal : literals) {
+            sat.add_clause({ SatSolver::negate(literal) });
+        }
         return;
     }
 
-    // start assume!
-    auto cells1 = board->get_total_cells();
-    for (auto i = 0; i < cells1; i++) {
-        const auto& cell = (*board)[i];
-        if (!cell.closed()) {
-            // closed only
-            continue;
+    // counter[i][j] is implied when more than j of literals[0..i] are true.
+    std::vector<std::vector<int>> counter(n - 1, std::vector<int>(k));
+    for (auto& row : counter) {
+        for (auto& var : row) {
+            var = sat.new_var();
         }
+    }
+    for (auto i = 0; i < n; i++) {
+        const auto literal = SatSolver::negate(literals[i]);
+        if (i < n - 1) {
+            sat.add_clause({ literal, SatSolver::positive(counter[i][0]) });
+            for (auto j = 0; i > 0 && j < k; j++) {
+                sat.add_clause({ SatSolver::negative(counter[i - 1][j]), SatSolver::positive(counter[i][j]) });
+                if (j > 0) {
+                    sat.add_clause({ literal, SatSolver::negative(counter[i - 1][j - 1]), SatSolver::positive(counter[i][j]) });
+                }
+            }
+        }
+        if (i > 0) {
+            sat.add_clause({ literal, SatSolver::negative(counter[i - 1][k - 1]) });
+        }
+    }
+}
+}
 
-        bool surrounded_by_nonassumption_open = false;
-        for (auto dir : ALL_DIRECTIONS) {
-            auto next_index = board->get_cell_index(i, dir);
-            if (!next_index.has_value())
-                continue;
-            const auto& next_cell = (*board)[next_index.value()];
-            if (next_cell.opened() && !next_cell.is_assumption()) {
-                surrounded_by_nonassumption_open = true;
-                break;
+void MineAI::sat_sync()
+{
+    const auto& board = state.board();
+    const auto cells = state.total_cells();
+    if (!sat) {
+        sat = std::make_unique<SatSolver>();
+        for (auto i = 0; i < cells; i++) {
+            sat->new_var();
+        }
+        sat_numbers.resize(cells);
+        sat_safe.resize(cells);
+        sat_mine.resize(cells);
+    }
+
+    for (auto w = 0; w < state.revealed().word_count(); w++) {
+        for (auto bits = state.revealed().word(w) & ~sat_numbers.word(w); bits != 0; bits &= bits - 1) {
+            const auto i = w * BitPlane::WORD_BITS + lowest_bit(bits);
+            sat_numbers.set(i);
+
+            // exactly number of the neighbors: at most number of them are
+            // mines, and at most size - number of them are safe.
+            const auto around = board.neighbors(i);
+            const auto size = static_cast<int>(around.size());
+            const auto number = state.number(i);
+            std::vector<SatSolver::Literal> mines;
+            std::vector<SatSolver::Literal> safes;
+            for (auto next : around) {
+                mines.push_back(SatSolver::positive(next));
+                safes.push_back(SatSolver::negative(next));
             }
+            add_at_most(*sat, mines, number);
+            add_at_most(*sat, safes, size - number);
         }
-        if (!surrounded_by_nonassumption_open) {
-            // surrounded by non-assumption open only
-            continue;
+        for (auto bits = state.safe().word(w) & ~sat_safe.word(w); bits != 0; bits &= bits - 1) {
+            const auto i = w * BitPlane::WORD_BITS + lowest_bit(bits);
+            sat_safe.set(i);
+            sat->add_clause({ SatSolver::negative(i) });
+        }
+        for (auto bits = state.mine().word(w) & ~sat_mine.word(w); bits != 0; bits &= bits - 1) {
+            const auto i = w * BitPlane::WORD_BITS + lowest_bit(bits);
+            sat_mine.set(i);
+            sat->add_clause({ SatSolver::positive(i) });
+        }
+    }
+}
+
+Step MineAI::sat_deduce()
+{
+    sat_sync();
+    const auto model = sat->solve({}, sat_max_conflicts);
+    if (model == SatSolver::Result::Unsat) {
+        return contradiction("no mine configuration fits the numbers");
+    }
+    if (model == SatSolver::Result::Unknown) {
+        return Step::Stuck;
+    }
+
+    // a cell is forced when no model gives it the other value; every model
+    // found on the way rules out the cells it disagrees on.
+    const auto& board = state.board();
+    std::vector<int> candidates;
+    std::vector<bool> first;
+    BitPlane seen(state.total_cells());
+    state.frontier().for_each([&](int cell) {
+        for (auto next : board.neighbors(cell)) {
+            if (state.is_unknown(next) && !seen.test(next)) {
+                seen.set(next);
+                candidates.push_back(next);
+                first.push_back(sat->model_value(next));
+            }
         }
+    });
 
-        if (log_enabled) {
-            std::cout << "ASSUME closed cell as flagged (entering level "
-                      << assume_nest_level + 1 << ") " << i << std::endl;
+    int resolved = 0;
+    std::vector<bool> open(candidates.size(), true);
+    for (std::size_t c = 0; c < candidates.size(); c++) {
+        if (!open[c]) {
+            continue;
         }
-        auto new_board = std::make_shared<Board>(*board);
-        (*new_board)[i].state() = CellState::Flagged;
-        (*new_board)[i].is_assumption() = true;
-        try {
-            if (solve_all(new_board, logging, cb, assume_nest_level + 1)) {
-                erase_assumption(*board, *new_board);
-                *board = *new_board;
-                return;
+        const auto i = candidates[c];
+        const auto other = first[c] ? SatSolver::negative(i) : SatSolver::positive(i);
+        const auto result = sat->solve({ other }, sat_max_conflicts);
+        if (result == SatSolver::Result::Sat) {
+            for (auto d = c; d < candidates.size(); d++) {
+                if (sat->model_value(candidates[d]) != first[d]) {
+                    open[d] = false;
+                }
             }
-        } catch (const AIReasoningError& e) {
+        } else if (result == SatSolver::Result::Unsat && state.is_unknown(i)) {
             if (log_enabled) {
-                std::cout << e.what() << std::endl;
-                std::cout << "ASSUME " << i << " failed (back to level "
-                          << assume_nest_level << ")" << std::endl;
+                std::cout << "Resolve cell " << i << " by SAT." << std::endl;
             }
+            if (first[c]) {
+                resolve_mine(i, Rule::Sat);
+            } else {
+                resolve_safe(i, Rule::Sat);
+            }
+            resolved++;
+        }
+    }
+    if (!state.consistent()) {
+        return contradiction("more cells known than the mine count allows");
+    }
+    return resolved > 0 ? Step::Progress : Step::Stuck;
+}
+
+Step MineAI::next_step(AICallback& cb)
+{
+    const auto timed = [this](Rule rule, auto&& stage) {
+        SOLVER_TRACE(PhaseBegin, -1, assume_nest_level, static_cast<int>(rule));
+        ScopedTimer timer(counters.seconds_in(rule));
+        const auto result = stage();
+        SOLVER_TRACE(PhaseEnd, -1, assume_nest_level, static_cast<int>(rule));
+        return result;
+    };
+
+    auto result = timed(Rule::SingleCell, [&] { return propagate(per_step ? 1 : -1); });
+    if (result != Step::Stuck) {
+        return result;
+    }
+
+    // table lookups, cheaper than any generic reasoning, so try them first.
+    if (enabled_stages & PATTERNS) {
+        result = timed(Rule::Pattern, [&] { return pattern_deduce(); });
+        if (result != Step::Stuck) {
+            return result;
         }
     }
 
-    // random strategy...
+    // polynomial, so cheap enough for speculation as well.
+    if (enabled_stages & LINEAR) {
+        result = timed(Rule::Linear, [&] { return linear_deduce(); });
+        if (result != Step::Stuck) {
+            return result;
+        }
+    }
+
+    if (backend_kind == Backend::Sat) {
+        return assume_nest_level == 0 ? timed(Rule::Sat, [&] { return sat_deduce(); }) : Step::Stuck;
+    }
+
+    // exact, but exponential in the component size, so only at the top.
+    // when every component was enumerated nothing else can prove more.
+    if (assume_nest_level == 0 && (enabled_stages & ENUMERATION)) {
+        EnumerationResult enumeration;
+        result = timed(Rule::Enumeration, [&] { return enumerate_deduce(enumeration); });
+        if (result != Step::Stuck || enumeration.complete) {
+            return result;
+        }
+    }
+
+    if (assume_nest_level >= max_nest_level || !(enabled_stages & SPECULATION)) {
+        return Step::Stuck;
+    }
+    return timed(Rule::Speculation, [&] { return assume_deduce(cb); });
+}
+
+Step MineAI::assume_deduce(AICallback& cb)
+{
+    const auto& board = state.board();
+    // start assume! unknown cells next to a revealed number only.
+    std::vector<int> candidates;
+    BitPlane seen(state.total_cells());
+    state.frontier().for_each([&](int cell) {
+        for (auto next : board.neighbors(cell)) {
+            if (state.is_unknown(next) && !seen.test(next)) {
+                seen.set(next);
+                candidates.push_back(next);
+            }
+        }
+    });
+
+    if (parallel && assume_nest_level == 0 && candidates.size() > 1 && TaskPool::shared().size() > 1) {
+        return refute_parallel(candidates) ? Step::Progress : Step::Stuck;
+    }
+
+    // a cell is proven when assuming the opposite leads to a contradiction.
+    for (const auto i : candidates) {
+        if (cb.cancelled()) {
+            break;
+        }
+        for (const auto assume_mine : { true, false }) {
+            if (refutes(i, assume_mine, cb)) {
+                if (assume_mine) {
+                    resolve_safe(i, Rule::Speculation);
+                } else {
+                    resolve_mine(i, Rule::Speculation);
+                }
+                return Step::Progress;
+            }
+        }
+    }
+
+    return Step::Stuck;
+}
+
+bool MineAI::refutes(int cell, bool assume_mine, AICallback& cb)
+{
+    if (log_enabled) {
+        std::cout << "ASSUME closed cell as " << (assume_mine ? "flagged" : "opened")
+                  << " (entering level " << assume_nest_level + 1 << ") " << cell << std::endl;
+    }
+    counters.branches_tried++;
+    SOLVER_TRACE(AssumeBegin, cell, assume_nest_level, assume_mine ? 1 : 0);
+    const auto checkpoint = state.checkpoint();
+    if (assume_mine) {
+        state.mark_mine(cell);
+    } else {
+        state.mark_safe(cell);
+    }
+    const auto contradiction = speculate(cb) == Step::Contradiction;
+    state.rollback(checkpoint);
+    SOLVER_TRACE(AssumeEnd, cell, assume_nest_level, contradiction ? 1 : 0);
+    if (contradiction) {
+        counters.branches_failed++;
+    }
+
+    if (contradiction && log_enabled) {
+        std::cout << "ASSUME " << cell << " failed (back to level "
+                  << assume_nest_level << ")" << std::endl;
+    }
+    return contradiction;
+}
+
+namespace {
+// stops a branch's speculation once a sibling has proven something.
+struct CancelCallback : public IgnoreSteps {
+    const TaskGroup& group;
+
+    explicit CancelCallback(const TaskGroup& group)
+        : group(group)
+    {
+    }
+    bool cancelled() const override { return group.cancelled(); }
+};
+}
+
+bool MineAI::refute_parallel(const std::vector<int>& candidates)
+{
+    auto& pool = TaskPool::shared();
+    const auto branches = std::min<std::size_t>(pool.size(), candidates.size());
+    std::atomic<std::size_t> next { 0 };
+    // index into candidates * 2, plus 1 if the cell was refuted as a mine.
+    std::atomic<long long> winner { -1 };
+    std::mutex merge_mutex;
+
+    TaskGroup group(pool);
+    for (std::size_t b = 0; b < branches; b++) {
+        group.run([&] {
+            // one copy of the knowledge per branch, reused for each candidate.
+            MineAI branch(state);
+            branch.max_nest_level = max_nest_level;
+            branch.enabled_stages = enabled_stages;
+            CancelCallback cb(group);
+            const auto refute_next = [&] {
+                for (auto c = next++; c < candidates.size() && !group.cancelled(); c = next++) {
+                    for (const auto assume_mine : { true, false }) {
+                        if (branch.refutes(candidates[c], assume_mine, cb)) {
+                            long long expected = -1;
+                            if (winner.compare_exchange_strong(expected, static_cast<long long>(c) * 2 + (assume_mine ? 1 : 0))) {
+                                group.cancel();
+                            }
+                            return;
+                        }
+                        if (group.cancelled()) {
+                            return;
+                        }
+                    }
+                }
+            };
+            refute_next();
+
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            counters.merge(branch.counters);
+        });
+    }
+    group.wait();
+    counters.state_copies += branches;
+
+    if (winner < 0) {
+        return false;
+    }
+    const auto cell = candidates[winner / 2];
     if (log_enabled) {
-        board->show_game_state(std::cerr, true);
-        std::cerr << std::endl;
+        std::cout << "ASSUME " << cell << " as " << (winner % 2 ? "flagged" : "opened")
+                  << " failed in a parallel branch" << std::endl;
     }
-    throw AIReasoningError("NO LOGIC");
+    if (winner % 2) {
+        resolve_safe(cell, Rule::Speculation);
+    } else {
+        resolve_mine(cell, Rule::Speculation);
+    }
+    return true;
 }
 
-namespace minesweeper {
-struct DoNothing : public AICallback {
-    void before_start(const std::shared_ptr<Board>&) override {};
-    bool on_step(const std::shared_ptr<Board>&, int, int) override { return true; };
+namespace {
+// ends a check once the builder's stop condition holds.
+struct StopCallback : public IgnoreSteps {
+    const std::function<bool()>& stop;
+
+    explicit StopCallback(const std::function<bool()>& stop)
+        : stop(stop)
+    {
+    }
+    bool cancelled() const override { return stop && stop(); }
 };
 }
 
-Board* BoardBuilder::generateLogicalBoard(std::function<Board*()> generator, std::optional<int> maxAttempts)
+BoardBuilder::BoardBuilder()
+    : strategy(StrategyRegistry::default_name())
+{
+}
+
+std::unique_ptr<SolverStrategy> BoardBuilder::checker(bool in_parallel_attempt) const
 {
+    auto solver = StrategyRegistry::create(strategy);
+    if (!solver) {
+        throw std::invalid_argument("unknown solver strategy: " + strategy);
+    }
+    if (auto* configurable = dynamic_cast<MineAIStrategy*>(solver.get())) {
+        configurable->parallel_branches() = branches && !in_parallel_attempt;
+    }
+    return solver;
+}
+
+Board* BoardBuilder::generateLogicalBoard(std::function<Board*(Seed)> generator, std::optional<int> maxAttempts, std::optional<Seed> seed)
+{
+    seconds = 0.0;
+    totals = SolverMetrics();
+    repair_budget = max_repairs.value_or(seed.has_value() ? 0 : DEFAULT_REPAIR_LIMIT);
+    ScopedTimer timer(seconds);
+    const auto base_seed = seed.has_value() ? seed.value() : random_seed();
+    const auto workers = worker_count > 0 ? worker_count : TaskPool::shared().size();
+    const auto solver = checker(workers > 1);
+    if (workers > 1) {
+        return generate_parallel(generator, maxAttempts, base_seed, *solver, workers);
+    }
+
+    const auto* repairable = dynamic_cast<const MineAIStrategy*>(solver.get());
     while (true) {
         attempts++;
-        if (maxAttempts.has_value() && maxAttempts.value() < attempts) {
+        if ((maxAttempts.has_value() && maxAttempts.value() < attempts) || stopped()) {
             return nullptr;
         }
 
         // emit nextAttempt(attempts);
 
-        Board* board = generator();
+        const auto attempt_seed = derive_seed(base_seed, attempts);
+        Board* board = generator(attempt_seed);
         if (board == nullptr) {
-            std::cerr << "generator fail" << std::endl;
+            if (!silent) {
+                std::cerr << "generator fail" << std::endl;
+            }
             continue;
         }
 
-        if (aiCheck(*board)) {
-            std::cerr << "AI check success" << std::endl;
+        repairs = 0;
+        const auto solved = aiCheck(*board);
+        totals.merge(last_check.metrics);
+        if (solved) {
+            if (!silent) {
+                std::cerr << "AI check success" << std::endl;
+            }
             return board;
-        } else {
+        }
+        if (last_check.result == SolveResult::Stuck && repairable != nullptr && repair_budget > 0) {
+            StopCallback cb(stop);
+            last_check = repair(*board, *repairable, attempt_seed, cb, repairs);
+            totals.merge(last_check.metrics);
+            if (last_check.result == SolveResult::Solved) {
+                if (!silent) {
+                    std::cerr << "AI check success" << std::endl;
+                }
+                return board;
+            }
+        }
+        if (!silent) {
             std::cerr << "AI check failed" << std::endl;
-            delete board;
         }
+        delete board;
     }
 }
 
+namespace {
+// stops checking an attempt once an earlier one has produced a board, or
+// once the builder's stop condition holds.
+struct SupersededCallback : public StopCallback {
+    const std::atomic<int>& best;
+    int attempt;
+
+    SupersededCallback(const std::function<bool()>& stop, const std::atomic<int>& best, int attempt)
+        : StopCallback(stop)
+        , best(best)
+        , attempt(attempt)
+    {
+    }
+    bool cancelled() const override { return attempt >= best || StopCallback::cancelled(); }
+};
+}
+
+Board* BoardBuilder::generate_parallel(const std::function<Board*(Seed)>& generator, std::optional<int> maxAttempts, Seed base_seed, const SolverStrategy& solver, unsigned workers)
+{
+    // attempt numbers are handed out in order and the lowest one that passes
+    // wins, which is the one the serial loop would have returned. Attempts
+    // after it are abandoned, those before it still run to the end.
+    std::atomic<int> next { attempts };
+    std::atomic<int> best { std::numeric_limits<int>::max() };
+    std::atomic<int> started { 0 };
+    std::mutex mutex;
+    std::unique_ptr<Board> found;
+    const auto* repairable = dynamic_cast<const MineAIStrategy*>(&solver);
+
+    TaskGroup group(TaskPool::shared());
+    for (unsigned w = 0; w < workers; w++) {
+        group.run([&] {
+            while (true) {
+                const auto attempt = ++next;
+                if (attempt >= best || (maxAttempts.has_value() && maxAttempts.value() < attempt) || stopped() || group.cancelled()) {
+                    return;
+                }
+                started++;
+
+                const auto attempt_seed = derive_seed(base_seed, attempt);
+                std::unique_ptr<Board> board(generator(attempt_seed));
+                if (!board) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!silent) {
+                        std::cerr << "generator fail" << std::endl;
+                    }
+                    continue;
+                }
+
+                SupersededCallback cb(stop, best, attempt);
+                auto stats = solver.solve(*board, cb);
+                int repairs_made = 0;
+                if (stats.result == SolveResult::Stuck && repairable != nullptr && repair_budget > 0) {
+                    stats = repair(*board, *repairable, attempt_seed, cb, repairs_made);
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                totals.merge(stats.metrics);
+                if (stats.result == SolveResult::Solved && attempt < best) {
+                    if (!silent) {
+                        std::cerr << "AI check success" << std::endl;
+                    }
+                    found = std::move(board);
+                    last_check = stats;
+                    repairs = repairs_made;
+                    best = attempt;
+                } else if (stats.result != SolveResult::Stopped && !silent) {
+                    std::cerr << "AI check failed" << std::endl;
+                }
+            }
+        });
+    }
+    group.wait();
+
+    attempts += started;
+    return found.release();
+}
+
+namespace {
+// Picks a revealed number the solver is stuck at and moves mines so that all
+// of its unknown neighbors become mines, or all of them become safe, which
+// the single-cell rule then resolves. Mines are swapped with unknown cells
+// away from the revealed area where possible, so few other numbers change.
+// Returns the cells whose mine changed; empty if there was nothing to move.
+std::vector<int> unstick(Board& board, const SolverState& state, std::mt19937_64& random)
+{
+    std::vector<int> numbers;
+    state.frontier().for_each([&](int cell) { numbers.push_back(cell); });
+    if (numbers.empty()) {
+        return {};
+    }
+    const auto pick = numbers[random() % numbers.size()];
+
+    const auto cells = state.total_cells();
+    BitPlane around(cells);
+    int mines = 0;
+    int unknown = 0;
+    for (auto next : board.neighbors(pick)) {
+        if (state.is_unknown(next)) {
+            around.set(next);
+            unknown++;
+            mines += board.has_bomb(next) ? 1 : 0;
+        }
+    }
+
+    // cells to trade mines with, those next to a revealed number last.
+    std::vector<int> far_mines, far_empty, near_mines, near_empty;
+    for (auto i = 0; i < cells; i++) {
+        if (!state.is_unknown(i) || around.test(i)) {
+            continue;
+        }
+        bool near = false;
+        for (auto next : board.neighbors(i)) {
+            near = near || state.is_revealed(next);
+        }
+        auto& pool = board.has_bomb(i) ? (near ? near_mines : far_mines) : (near ? near_empty : far_empty);
+        pool.push_back(i);
+    }
+    const auto available_mines = far_mines.size() + near_mines.size();
+    const auto available_empty = far_empty.size() + near_empty.size();
+
+    // clearing moves each mine out, filling moves unknown - mines in.
+    const auto can_clear = available_empty >= static_cast<std::size_t>(mines);
+    const auto can_fill = available_mines >= static_cast<std::size_t>(unknown - mines);
+    if (!can_clear && !can_fill) {
+        return {};
+    }
+    const auto clear = can_clear && (!can_fill || mines < unknown - mines || (mines == unknown - mines && random() % 2 == 0));
+
+    // takes a random cell from the far pool, or the near one once it is empty.
+    const auto take = [&](std::vector<int>& far, std::vector<int>& near) {
+        auto& pool = far.empty() ? near : far;
+        const auto k = random() % pool.size();
+        const auto cell = pool[k];
+        pool[k] = pool.back();
+        pool.pop_back();
+        return cell;
+    };
+
+    std::vector<int> moved;
+    around.for_each([&](int cell) {
+        if (clear && board.has_bomb(cell)) {
+            const auto to = take(far_empty, near_empty);
+            board.move_bomb(cell, to);
+            moved.push_back(cell);
+            moved.push_back(to);
+        } else if (!clear && !board.has_bomb(cell)) {
+            const auto from = take(far_mines, near_mines);
+            board.move_bomb(from, cell);
+            moved.push_back(from);
+            moved.push_back(cell);
+        }
+    });
+    return moved;
+}
+}
+
+SolveStats BoardBuilder::repair(Board& board, const MineAIStrategy& solver, Seed seed, AICallback& cb, int& repairs_made) const
+{
+    std::mt19937_64 random(derive_seed(seed, 0));
+    const auto opened = board.opened();
+    SolveStats stats;
+    stats.result = SolveResult::Stuck;
+    while (stats.result == SolveResult::Stuck && repairs_made < repair_budget) {
+        MineAI ai(board);
+        solver.configure(ai);
+        auto result = ai.run(cb);
+        while (result == SolveResult::Stuck && repairs_made < repair_budget) {
+            const auto moved = unstick(board, ai.knowledge(), random);
+            if (moved.empty()) {
+                break;
+            }
+            repairs_made++;
+            ai.mines_moved(moved);
+            result = ai.run(cb);
+        }
+        if (result != SolveResult::Solved) {
+            stats.result = result;
+            break;
+        }
+
+        // the numbers around the moved mines changed, so open the cells the
+        // generator opened again; a number that became 0 opens more.
+        opened.for_each([&](int cell) { board.set_state(cell, CellState::Closed); });
+        opened.for_each([&](int cell) {
+            if (board.state(cell) != CellState::Opened) {
+                board.open_cell(cell);
+            }
+        });
+        // what was carried over may rest on numbers that have changed since,
+        // so make sure the repaired board can be solved from the start.
+        stats = solver.solve(board, cb);
+    }
+    return stats;
+}
+
 bool BoardBuilder::aiCheck(const Board& board)
 {
-    board.show_game_state(std::cout, false);
-    std::cout << std::endl;
-    try {
-        DoNothing cb;
+    if (!silent) {
+        board.show_game_state(std::cout, false);
         std::cout << std::endl;
-        return MineAI::solve_all(std::make_shared<Board>(board),
-            false, cb);
-    } catch (const AIReasoningError& e) {
-        std::cerr << e.what() << std::endl;
-        return false;
+        std::cout << std::endl;
+    }
+    const auto solver = checker();
+    StopCallback cb(stop);
+    last_check = solver->solve(board, cb);
+    if (!silent && last_check.result == SolveResult::Stuck) {
+        std::cerr << "NO LOGIC" << std::endl;
+    } else if (!silent && last_check.result == SolveResult::Contradiction) {
+        std::cerr << "CONTRADICTION" << std::endl;
     }
+    return last_check.result == SolveResult::Solved;
 }
@@ -1,64 +1,297 @@
 #pragma once
 
 #include "board.h"
+#include "enumerator.h"
+#include "gaussian.h"
+#include "satsolver.h"
+#include "solverstate.h"
+#include "solvermetrics.h"
+#include "taskpool.h"
 #include <memory>
-#include <array>
 #include <functional>
 #include <optional>
-#include <stdexcept>
+#include <string>
 
 namespace minesweeper {
 
-class AIReasoningError : public std::runtime_error {
-public:
-    AIReasoningError(const std::string& what)
-        : std::runtime_error(what)
-    {
-    }
+// outcome of one solver step.
+enum class Step {
+    // at least one cell was resolved.
+    Progress,
+    // nothing new can be proven.
+    Stuck,
+    // no mine configuration fits what is known. Expected while speculating;
+    // outside of it the board itself is inconsistent.
+    Contradiction
+};
+
+// outcome of a whole run.
+enum class SolveResult {
+    Solved,
+    // the callback asked to stop, or the board being played was lost.
+    Stopped,
+    // no cell can be proven without guessing.
+    Stuck,
+    Contradiction
 };
 
-constexpr std::array<Direction, 8> ALL_DIRECTIONS = {
-    Direction::LeftUp, Direction::Up, Direction::RightUp,
-    Direction::Left, Direction::Right, Direction::LeftDown,
-    Direction::Down, Direction::RightDown
+// what any solver strategy reports about a run.
+struct SolveStats {
+    std::string strategy;
+    SolveResult result = SolveResult::Stuck;
+    // top-level steps that made progress.
+    int steps = 0;
+    // cells known to be safe / mines when the run ended.
+    int safe = 0;
+    int mines = 0;
+    double seconds = 0.0;
+    SolverMetrics metrics;
 };
 
 struct AICallback {
-    virtual void before_start(const std::shared_ptr<Board>& board) = 0;
-    virtual bool on_step(const std::shared_ptr<Board>& board, int current_step, int nest_level) = 0;
+    virtual void before_start(const SolverState& state) = 0;
+    virtual bool on_step(const SolverState& state, int current_step, int nest_level) = 0;
+    // once per run, with what the run did.
+    virtual void on_finish(const SolverState&, const SolverMetrics&) {}
+    // polled between the assumptions of a step, which can take long on a
+    // large frontier; true ends the run as SolveResult::Stopped.
+    virtual bool cancelled() const { return false; }
+};
+
+// for runs nobody watches: only stops them early once cancelled() is
+// overridden to say so.
+struct IgnoreSteps : public AICallback {
+    void before_start(const SolverState&) override { }
+    bool on_step(const SolverState&, int, int) override { return !cancelled(); }
 };
 
 class MineAI {
-    std::shared_ptr<Board> board;
-    bool log_enabled;
-    bool firsttime = true;
+public:
+    // how cells the rules cannot reach are proven.
+    enum class Backend {
+        // assume a value, propagate, and look for a contradiction.
+        Speculation,
+        // ask a SAT solver whether the opposite value is satisfiable.
+        Sat
+    };
+
+    // the stages next_step() may use besides the single-cell rule.
+    enum Stage : unsigned {
+        PATTERNS = 1u << 0,
+        LINEAR = 1u << 1,
+        ENUMERATION = 1u << 2,
+        SPECULATION = 1u << 3,
+        ALL_STAGES = PATTERNS | LINEAR | ENUMERATION | SPECULATION
+    };
+
+private:
+    SolverState state;
+    // moves proven outside speculation are also played here, if set.
+    Board* playing = nullptr;
+    bool log_enabled = false;
     int assume_nest_level = 0;
+    int max_nest_level = 1;
+    bool per_step = false;
+    bool parallel = true;
+    unsigned enabled_stages = ALL_STAGES;
+    GaussianEliminator eliminator;
+    FrontierEnumerator enumerator;
+
+    Backend backend_kind = Backend::Speculation;
+    long long sat_max_conflicts = 10000;
+    // one var per cell. Numbers and known cells are added as they appear.
+    std::unique_ptr<SatSolver> sat;
+    BitPlane sat_numbers;
+    BitPlane sat_safe;
+    BitPlane sat_mine;
+
+    // includes the branches run in parallel.
+    SolverMetrics counters;
+
+    void sat_sync();
+    void resolve_safe(int index, Rule rule);
+    void resolve_mine(int index, Rule rule);
+    Step speculate(AICallback& cb);
+    // tries each frontier cell both ways until one of them is refuted.
+    Step assume_deduce(AICallback& cb);
+    // logs reason and returns Step::Contradiction.
+    Step contradiction(const char* reason) const;
+    // true if assuming the value of cell leads to a contradiction.
+    bool refutes(int cell, bool assume_mine, AICallback& cb);
+    bool refute_parallel(const std::vector<int>& candidates);
+    // a solver on a copy of the current knowledge, for one speculative branch.
+    explicit MineAI(const SolverState& knowledge);
 
 public:
-    MineAI(std::shared_ptr<Board> board);
+    // reasons about board without ever modifying it.
+    explicit MineAI(const Board& board);
+    // also opens and flags the cells it proves on board.
+    static MineAI player(Board& board);
 
     bool& logging() { return log_enabled; }
     const bool& logging() const { return log_enabled; }
 
-    void next_step(bool logging, AICallback& cb);
+    // how many assumptions may be stacked on top of each other.
+    int& max_nest() { return max_nest_level; }
+    const int& max_nest() const { return max_nest_level; }
+
+    // one deduction per next_step, so callbacks can animate each move.
+    // By default each step runs the simple rules to a fixpoint.
+    bool& per_step_callbacks() { return per_step; }
+    const bool& per_step_callbacks() const { return per_step; }
+
+    // top-level assumptions are tried concurrently on TaskPool::shared(),
+    // each worker on its own copy of the knowledge. Callbacks are not called
+    // from the branches.
+    bool& parallel_branches() { return parallel; }
+    const bool& parallel_branches() const { return parallel; }
+
+    // a mask of Stage values.
+    unsigned& stages() { return enabled_stages; }
+    const unsigned& stages() const { return enabled_stages; }
+
+    Backend& backend() { return backend_kind; }
+    const Backend& backend() const { return backend_kind; }
+
+    // conflicts allowed per SAT query, including the one that finds the
+    // first model; the stage is stuck when that one runs out.
+    long long& sat_conflict_limit() { return sat_max_conflicts; }
+    const long long& sat_conflict_limit() const { return sat_max_conflicts; }
+
+    const SolverState& knowledge() const { return state; }
+    const SolverMetrics& metrics() const { return counters; }
+
+    // applies the single-cell rules to queued cells until nothing is left
+    // or max_deductions (if not negative) rules have fired.
+    Step propagate(int max_deductions = -1);
 
-    bool static solve_all(std::shared_ptr<Board> board,
+    // what two numbers within two cells of each other prove together
+    // (the 1-1, 1-2 and 1-2-1 patterns), looked up in patterns::RULES.
+    Step pattern_deduce();
+
+    // row reduction of the frontier equations, see GaussianEliminator.
+    Step linear_deduce();
+
+    // exact enumeration of the frontier components, see FrontierEnumerator.
+    Step enumerate_deduce(EnumerationResult& result);
+
+    // mine probability of every cell given what is known now.
+    // empty if some frontier component was too large to enumerate.
+    std::vector<double> mine_probabilities() const;
+
+    // every frontier cell whose value holds in all models of the revealed
+    // numbers. The mine count is left to linear_deduce().
+    Step sat_deduce();
+
+    // runs the stages in order of cost until one of them makes progress.
+    Step next_step(AICallback& cb);
+
+    SolveResult run(AICallback& cb);
+
+    // the board moved mines into or out of the unknown cells, e.g.
+    // Board::move_bomb(). Everything known so far is kept, so run() picks up
+    // from here.
+    void mines_moved(const std::vector<int>& cells);
+
+    SolveResult static solve_all(const Board& board,
         bool logging,
         AICallback& cb);
-    bool static solve_all(std::shared_ptr<Board> board,
+    SolveResult static play_all(Board& board,
         bool logging,
         AICallback& cb,
-        int nest_level);
+        bool per_step = false);
 
     std::optional<int> open_any();
 };
 
+class SolverStrategy;
+class MineAIStrategy;
+
 class BoardBuilder {
     bool ai_is_solvable(const Board& board);
     int attempts = 0;
+    unsigned worker_count = 0;
+    std::optional<int> max_repairs;
+    // the repair limit of the current generateLogicalBoard() call.
+    int repair_budget = 0;
+    int repairs = 0;
+    double seconds = 0.0;
+    SolverMetrics totals;
+    std::string strategy;
+    SolveStats last_check;
+    std::function<bool()> stop;
+    bool silent = false;
+    bool branches = false;
+
+    // attempts checked in parallel never branch in parallel too.
+    std::unique_ptr<SolverStrategy> checker(bool in_parallel_attempt = false) const;
+    bool stopped() const { return stop && stop(); }
+    // moves mines next to where solver gets stuck until it solves board,
+    // at most repair_budget times; repairs_made counts the moves.
+    SolveStats repair(Board& board, const MineAIStrategy& solver, Seed seed,
+        AICallback& cb, int& repairs_made) const;
+    Board* generate_parallel(const std::function<Board*(Seed)>& generator,
+        std::optional<int> maxAttempts, Seed base_seed,
+        const SolverStrategy& solver, unsigned workers);
 
 public:
-    Board* generateLogicalBoard(std::function<Board*()> generator, std::optional<int> maxAttempts = std::make_optional(10));
+    // checks with StrategyRegistry::default_name() unless told otherwise.
+    BoardBuilder();
+
+    // name of the registered strategy aiCheck() proves boards with.
+    std::string& check_strategy() { return strategy; }
+    const SolveStats& last_check_stats() const { return last_check; }
+
+    // attempts made so far, by all workers together.
+    int attempt_count() const { return attempts; }
+
+    // how many attempts run at once; 0 means one per TaskPool::shared()
+    // worker, 1 runs them on the calling thread.
+    unsigned& workers() { return worker_count; }
+    const unsigned& workers() const { return worker_count; }
+
+    // a board the check gets stuck on is repaired by moving a few mines
+    // around the stuck frontier instead of being thrown away, up to this many
+    // times; 0 always starts over. Cells opened by the generator never get
+    // a mine. Repaired boards have no board_id(), so unless set, the limit
+    // is 0 when generateLogicalBoard() is given a seed and
+    // DEFAULT_REPAIR_LIMIT otherwise.
+    static constexpr int DEFAULT_REPAIR_LIMIT = 32;
+    std::optional<int>& repair_limit() { return max_repairs; }
+    const std::optional<int>& repair_limit() const { return max_repairs; }
+    // repairs made on the last board returned.
+    int repair_count() const { return repairs; }
+    // checked before every attempt and at every step of the checks; once it
+    // returns true, generateLogicalBoard() gives up and returns nullptr.
+    std::function<bool()>& stop_condition() { return stop; }
+
+    // no board dumps or progress lines on the standard streams.
+    bool& quiet() { return silent; }
+    const bool& quiet() const { return silent; }
+
+    // lets the checks of a single worker try assumptions concurrently on
+    // TaskPool::shared(), see MineAI::parallel_branches(). Off by default:
+    // which branch refutes first depends on timing, and with it what the
+    // budgeted stages find, so the board would no longer depend on the seed
+    // alone.
+    bool& parallel_branches() { return branches; }
+    const bool& parallel_branches() const { return branches; }
+
+    // wall time of the last generateLogicalBoard() call.
+    double generation_seconds() const { return seconds; }
+    // the metrics of every check and repair the last generateLogicalBoard()
+    // call ran.
+    const SolverMetrics& generation_metrics() const { return totals; }
+
+    // generator receives the seed for the attempt; attempt seeds are derived
+    // from seed, or from a random one if none is given. With more than one
+    // worker generator is called concurrently. The first attempt that passes
+    // aiCheck() is returned either way, so unless parallel_branches() is on,
+    // the board only depends on seed. Exceptions from generator or the checks
+    // reach the caller on any worker.
+    Board* generateLogicalBoard(std::function<Board*(Seed)> generator,
+        std::optional<int> maxAttempts = std::make_optional(10),
+        std::optional<Seed> seed = std::nullopt);
 
     bool aiCheck(const Board& board);
 
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace minesweeper {
+
+inline int popcount(std::uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int n = 0;
+    for (; word != 0; word &= word - 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+inline int lowest_bit(std::uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int n = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// One bit per cell, packed into 64-bit words.
+// Bits past size() in the last word are always kept zero.
+class BitPlane {
+public:
+    using Word = std::uint64_t;
+    static constexpr int WORD_BITS = 64;
+
+private:
+    int size_ = 0;
+    std::vector<Word> words_;
+
+public:
+    BitPlane() = default;
+    explicit BitPlane(int size) { resize(size); }
+
+    void resize(int size)
+    {
+        size_ = size;
+        words_.assign((size + WORD_BITS - 1) / WORD_BITS, 0);
+    }
+    void clear() { std::fill(words_.begin(), words_.end(), 0); }
+
+    int size() const { return size_; }
+    int word_count() const { return static_cast<int>(words_.size()); }
+
+    Word word(int w) const { return words_[w]; }
+    Word& word(int w) { return words_[w]; }
+
+    // valid bits of word w.
+    Word mask(int w) const
+    {
+        const int rest = size_ - w * WORD_BITS;
+        return rest >= WORD_BITS ? ~Word(0) : (Word(1) << rest) - 1;
+    }
+
+    bool test(int i) const { return (words_[i / WORD_BITS] >> (i % WORD_BITS)) & 1; }
+    void set(int i) { words_[i / WORD_BITS] |= Word(1) << (i % WORD_BITS); }
+    void reset(int i) { words_[i / WORD_BITS] &= ~(Word(1) << (i % WORD_BITS)); }
+    void assign(int i, bool value)
+    {
+        if (value) {
+            set(i);
+        } else {
+            reset(i);
+        }
+    }
+
+    int count() const
+    {
+        int n = 0;
+        for (auto w : words_) {
+            n += popcount(w);
+        }
+        return n;
+    }
+
+    bool any() const
+    {
+        for (auto w : words_) {
+            if (w != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // calls f(index) for every set bit, in increasing order.
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (int w = 0; w < word_count(); w++) {
+            for (auto bits = words_[w]; bits != 0; bits &= bits - 1) {
+                f(w * WORD_BITS + lowest_bit(bits));
+            }
+        }
+    }
+
+    bool operator==(const BitPlane& other) const { return size_ == other.size_ && words_ == other.words_; }
+    bool operator!=(const BitPlane& other) const { return !(*this == other); }
+};
+
+}
@@ -1,39 +1,175 @@
 #include "board.h"
 #include "ai.h"
+#include "boardpool.h"
+#include "strategy.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <mutex>
 #include <random>
 #include <stdexcept>
 #include <string>
 #include <tuple>
 #include <optional>
 #include <iostream>
+#include <iterator>
+#include <limits>
 
 using namespace minesweeper;
 
-Board::Board(int width, int height, int n_bombs, bool initialize)
+NeighborTable::NeighborTable(int width, int height)
+    : width_(width), height_(height), indices_(width * height * STRIDE, 0), counts_(width * height, 0)
+{
+    // row by row, the order neighbors() lists them in.
+    const std::array<std::pair<int, int>, 8> offsets = {{{-1, -1}, {0, -1}, {1, -1},
+                                                         {-1, 0}, {1, 0},
+                                                         {-1, 1}, {0, 1}, {1, 1}}};
+    for (auto row = 0; row < height; row++)
+    {
+        for (auto column = 0; column < width; column++)
+        {
+            const auto index = column + row * width;
+            auto count = 0;
+            for (const auto &offset : offsets)
+            {
+                const auto c = column + offset.first;
+                const auto r = row + offset.second;
+                if (c >= 0 && c < width && r >= 0 && r < height)
+                {
+                    indices_[index * STRIDE + count++] = c + r * width;
+                }
+            }
+            counts_[index] = static_cast<std::uint8_t>(count);
+        }
+    }
+}
+
+std::shared_ptr<const NeighborTable>
+NeighborTable::get(int width, int height)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<int, int>, std::weak_ptr<const NeighborTable>> tables;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &slot = tables[std::make_pair(width, height)];
+    auto table = slot.lock();
+    if (!table)
+    {
+        table = std::make_shared<const NeighborTable>(width, height);
+        slot = table;
+        // drop the sizes no board uses any more, so the map stays small.
+        for (auto it = tables.begin(); it != tables.end();)
+        {
+            it = it->second.expired() ? tables.erase(it) : std::next(it);
+        }
+    }
+    return table;
+}
+
+Seed minesweeper::random_seed()
+{
+    std::random_device seeder;
+    return (static_cast<Seed>(seeder()) << 32) ^ seeder();
+}
+
+std::string BoardId::to_string() const
+{
+    char buffer[96];
+    if (first_click >= 0 && exclusion_radius > 0)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%dx%d-%d-%" PRIx64 "-%dr%d", width, height, bombs, seed, first_click, exclusion_radius);
+    }
+    else if (first_click >= 0)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%dx%d-%d-%" PRIx64 "-%d", width, height, bombs, seed, first_click);
+    }
+    else
+    {
+        std::snprintf(buffer, sizeof(buffer), "%dx%d-%d-%" PRIx64, width, height, bombs, seed);
+    }
+    return buffer;
+}
+
+std::optional<BoardId> BoardId::parse(const std::string &text)
+{
+    // sscanf would also skip blanks and take signs before every number,
+    // none of which to_string() writes; a '-' can only be a separator.
+    const auto stray = [](unsigned char c) { return std::isspace(c) || c == '+'; };
+    if (std::any_of(text.begin(), text.end(), stray) || text.find("--") != std::string::npos || text.empty() || text.front() == '-')
+    {
+        return std::optional<BoardId>();
+    }
+
+    // %n is only reached, and end only set, if everything before it matched.
+    const auto length = static_cast<int>(text.size());
+    BoardId id;
+    std::uint64_t seed = 0;
+    auto end = -1;
+    std::sscanf(text.c_str(), "%dx%d-%d-%" SCNx64 "-%dr%d%n", &id.width, &id.height, &id.bombs, &seed, &id.first_click, &id.exclusion_radius, &end);
+    if (end != length)
+    {
+        id.exclusion_radius = 0;
+        std::sscanf(text.c_str(), "%dx%d-%d-%" SCNx64 "-%d%n", &id.width, &id.height, &id.bombs, &seed, &id.first_click, &end);
+    }
+    if (end != length)
+    {
+        id.first_click = -1;
+        std::sscanf(text.c_str(), "%dx%d-%d-%" SCNx64 "%n", &id.width, &id.height, &id.bombs, &seed, &end);
+    }
+    if (end != length || id.width <= 0 || id.height <= 0 || id.exclusion_radius < 0)
+    {
+        return std::optional<BoardId>();
+    }
+    const auto cells = static_cast<long long>(id.width) * id.height;
+    if (cells > std::numeric_limits<int>::max() || id.first_click >= cells)
+    {
+        return std::optional<BoardId>();
+    }
+
+    // the mines have to fit outside the cells kept free around the click.
+    auto free_cells = 0LL;
+    if (id.first_click >= 0)
+    {
+        const auto column = id.first_click % id.width;
+        const auto row = id.first_click / id.width;
+        const auto radius = static_cast<long long>(id.exclusion_radius);
+        const auto columns = std::min<long long>(id.width - 1, column + radius) - std::max<long long>(0, column - radius) + 1;
+        const auto rows = std::min<long long>(id.height - 1, row + radius) - std::max<long long>(0, row - radius) + 1;
+        free_cells = columns * rows;
+    }
+    if (id.bombs < 0 || id.bombs >= cells || id.bombs > cells - free_cells)
+    {
+        return std::optional<BoardId>();
+    }
+    id.seed = seed;
+    return id;
+}
+
+Board::Board(int width, int height, int n_bombs, bool initialize, std::optional<Seed> seed)
     : width_(width), height_(height), init_bombs_(n_bombs)
 {
     if (width <= 0 || height <= 0 || n_bombs < 0 || n_bombs >= width * height)
     {
         throw std::runtime_error("illegal arguments");
     }
+    neighbors_ = NeighborTable::get(width, height);
     if (initialize)
     {
-        setup_cells(width, height, n_bombs);
+        setup_cells(width, height, n_bombs, std::vector<int>(), seed.has_value() ? seed.value() : random_seed());
         build_neighbor_map();
     }
     else
     {
-        auto cells = width * height;
-        for (auto i = 0; i < cells; i++)
-        {
-            cells_.push_back(Cell(false));
-        }
+        resize_planes(width * height);
     }
 }
 
-Board::Board(int width, int height, int n_bombs, const std::vector<int> &excludes, bool ai_check)
-    : width_(width), height_(height), init_bombs_(n_bombs)
+Board::Board(int width, int height, int n_bombs, const std::vector<int> &excludes, bool ai_check, std::optional<Seed> seed)
+    : width_(width), height_(height), init_bombs_(n_bombs), neighbors_(NeighborTable::get(width, height))
 {
     if (n_bombs >= width * height - excludes.size())
     {
@@ -45,10 +181,10 @@ Board::Board(int width, int height, int n_bombs, const std::vector<int> &exclude
     // QEventLoop::connect(&builder, &BoardBuilder::nextAttempt, [](int attempts) {
     //     qDebug("Attempt #%d", attempts);
     // });
-    auto newBoard = dynamic_cast<Board *>(builder.generateLogicalBoard([self = *this, excludes]() {
+    auto newBoard = dynamic_cast<Board *>(builder.generateLogicalBoard([self = *this, excludes](Seed attempt_seed) {
         auto *b = new Board(self);
         b->initAll();
-        b->setup_cells(self.width_, self.height_, self.init_bombs_, excludes);
+        b->setup_cells(self.width_, self.height_, self.init_bombs_, excludes, attempt_seed);
         b->build_neighbor_map();
         for (auto ex : excludes)
         {
@@ -56,7 +192,7 @@ Board::Board(int width, int height, int n_bombs, const std::vector<int> &exclude
         }
         return b;
     },
-                                                                       std::optional<int>() /* unlimited */));
+                                                                       std::optional<int>() /* unlimited */, seed));
     if (newBoard == nullptr)
     {
         std::cerr << "could not generate new board" << std::endl;
@@ -66,7 +202,8 @@ Board::Board(int width, int height, int n_bombs, const std::vector<int> &exclude
     delete newBoard;
 }
 
-Board::Board(int width, int height, int n_bombs, const std::vector<Board::Point> &excludes, bool ai_check)
+Board::Board(int width, int height, int n_bombs, const std::vector<Board::Point> &excludes, bool ai_check, std::optional<Seed> seed)
+    : width_(width), height_(height), init_bombs_(n_bombs), neighbors_(NeighborTable::get(width, height))
 {
     if (n_bombs >= width * height - excludes.size())
     {
@@ -84,10 +221,10 @@ Board::Board(int width, int height, int n_bombs, const std::vector<Board::Point>
     // QEventLoop::connect(&builder, &BoardBuilder::nextAttempt, [](int attempts) {
     //     qDebug("Attempt #%d", attempts);
     // });
-    auto newBoard = dynamic_cast<Board *>(builder.generateLogicalBoard([self = *this, &excludes_index]() {
+    auto newBoard = dynamic_cast<Board *>(builder.generateLogicalBoard([self = *this, &excludes_index](Seed attempt_seed) {
         auto *b = new Board(self);
         b->initAll();
-        b->setup_cells(self.width_, self.height_, self.init_bombs_, excludes_index);
+        b->setup_cells(self.width_, self.height_, self.init_bombs_, excludes_index, attempt_seed);
         b->build_neighbor_map();
         for (auto ex : excludes_index)
         {
@@ -95,7 +232,7 @@ Board::Board(int width, int height, int n_bombs, const std::vector<Board::Point>
         }
         return b;
     },
-                                                                       std::optional<int>() /* unlimited */));
+                                                                       std::optional<int>() /* unlimited */, seed));
     if (newBoard == nullptr)
     {
         std::cerr << "could not generate new board" << std::endl;
@@ -106,12 +243,19 @@ Board::Board(int width, int height, int n_bombs, const std::vector<Board::Point>
 }
 
 Board::Board(const Board &board)
-    : width_(board.width_), height_(board.height_), init_bombs_(board.init_bombs_), failed_(board.failed_), cells_(board.cells_)
+    : width_(board.width_), height_(board.height_), init_bombs_(board.init_bombs_), failed_(board.failed_), neighbors_(board.neighbors_),
+      seed_(board.seed_), first_click_(board.first_click_), exclusion_radius_(board.exclusion_radius_),
+      bombs_(board.bombs_), opened_(board.opened_), flagged_(board.flagged_),
+      neighbor_counts_(board.neighbor_counts_), revealed_(board.revealed_)
 {
 }
 
 Board::Board(Board &&board)
-    : width_(board.width_), height_(board.height_), init_bombs_(board.init_bombs_), failed_(board.failed_), cells_(std::move(board.cells_))
+    : width_(board.width_), height_(board.height_), init_bombs_(board.init_bombs_), failed_(board.failed_), neighbors_(board.neighbors_),
+      seed_(board.seed_), first_click_(board.first_click_), exclusion_radius_(board.exclusion_radius_),
+      bombs_(std::move(board.bombs_)), opened_(std::move(board.opened_)), flagged_(std::move(board.flagged_)),
+      neighbor_counts_(std::move(board.neighbor_counts_)),
+      revealed_(std::move(board.revealed_))
 {
 }
 
@@ -126,7 +270,15 @@ Board::operator=(const Board &board)
     height_ = board.height_;
     init_bombs_ = board.init_bombs_;
     failed_ = board.failed_;
-    cells_ = board.cells_;
+    neighbors_ = board.neighbors_;
+    seed_ = board.seed_;
+    first_click_ = board.first_click_;
+    exclusion_radius_ = board.exclusion_radius_;
+    bombs_ = board.bombs_;
+    opened_ = board.opened_;
+    flagged_ = board.flagged_;
+    neighbor_counts_ = board.neighbor_counts_;
+    revealed_ = board.revealed_;
     return *this;
 }
 
@@ -137,7 +289,15 @@ Board::operator=(Board &&board)
     height_ = board.height_;
     init_bombs_ = board.init_bombs_;
     failed_ = board.failed_;
-    cells_ = std::move(board.cells_);
+    neighbors_ = board.neighbors_;
+    seed_ = board.seed_;
+    first_click_ = board.first_click_;
+    exclusion_radius_ = board.exclusion_radius_;
+    bombs_ = std::move(board.bombs_);
+    opened_ = std::move(board.opened_);
+    flagged_ = std::move(board.flagged_);
+    neighbor_counts_ = std::move(board.neighbor_counts_);
+    revealed_ = std::move(board.revealed_);
     return *this;
 }
 
@@ -148,103 +308,461 @@ void Board::setup_cells(int width, int height, int n_bombs)
 
 void Board::setup_cells(int width, int height, int n_bombs, const std::vector<int> &excludes)
 {
-    std::random_device seeder;
-    std::mt19937 random;
-    random.seed(seeder());
+    setup_cells(width, height, n_bombs, excludes, random_seed());
+}
+
+void Board::setup_cells(int width, int height, int n_bombs, const std::vector<int> &excludes, Seed seed)
+{
+    // mt19937_64 output is fixed by the standard, so a seed names the same board everywhere.
+    std::mt19937_64 random(seed);
+    // a BoardId holds at most one excluded cell, so boards with several
+    // cannot be regenerated from their seed and get no board_id().
+    seed_ = excludes.size() <= 1 ? std::make_optional(seed) : std::nullopt;
+    first_click_ = excludes.size() == 1 ? excludes.front() : -1;
+    exclusion_radius_ = 0;
 
     auto cells = width * height;
-    for (auto i = 0; i < cells; i++)
+    resize_planes(cells);
+
+    BitPlane excluded(cells);
+    for (auto ex : excludes)
     {
-        cells_.push_back(Cell(false));
+        excluded.set(ex);
     }
 
-    std::vector<size_t> bomb_indices;
+    // reused across generation attempts on the same thread.
+    static thread_local std::vector<int> bomb_indices;
+    bomb_indices.clear();
     for (auto i = 0; i < cells; i++)
     {
-        if (std::find(excludes.cbegin(), excludes.cend(), i) == excludes.cend())
+        if (!excluded.test(i))
         {
             bomb_indices.push_back(i);
         }
     }
 
-    for (auto i = 0; i < n_bombs; i++)
+    // partial Fisher-Yates: the first n_bombs slots end up as a uniform sample.
+    const auto candidates = bomb_indices.size();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(n_bombs); i++)
     {
-        auto rand = random() % bomb_indices.size();
-        auto index = bomb_indices.at(rand);
-        bomb_indices.erase(bomb_indices.begin() + rand);
-        cells_[index].has_bomb() = true;
+        auto rand = i + random() % (candidates - i);
+        std::swap(bomb_indices[i], bomb_indices[rand]);
+        bombs_.set(bomb_indices[i]);
     }
 }
 
-void Board::build_neighbor_map()
+namespace
+{
+
+// rewrites allowed in setup_cells_constructive: this many, or one per this
+// many cells on larger boards.
+constexpr int MIN_REWRITES = 64;
+constexpr int CELLS_PER_REWRITE = 16;
+
+// A board whose mines are decided while a solver plays it: the neighbors of
+// a cell get their values, at the remaining density, when the cell is
+// opened. Whenever the solver gets stuck, force() rewrites the unknown
+// neighbors of one revealed number so that the number decides them, and the
+// solver goes on from what it knew, rechecking only the numbers next to the
+// rewritten cells. Only when known mines wall off the cells left is one of
+// them made safe, and the solver works out again what the opened cells
+// prove. Cells the solver never reaches are left to fill(), so the mine
+// count is always met.
+class ConstructionBoard : public Board
 {
-    std::array<Direction, 8> dirs = {Direction::LeftUp, Direction::Up,
-                                     Direction::RightUp, Direction::Left,
-                                     Direction::Right, Direction::LeftDown,
-                                     Direction::Down, Direction::RightDown};
-    for (auto i = 0; i < get_total_cells(); i++)
+    std::mt19937_64 random_;
+    BitPlane decided_;
+    int undecided_;
+    int placed_ = 0;
+
+    void set_bomb(int index, bool mine)
+    {
+        if (bombs_.test(index) == mine)
+        {
+            return;
+        }
+        bombs_.assign(index, mine);
+        placed_ += mine ? 1 : -1;
+        for (auto next : neighbors(index))
+        {
+            set_neighbor_bombs(next, neighbor_bombs(next) + (mine ? 1 : -1));
+        }
+    }
+
+    void place(int index, bool mine)
+    {
+        decided_.set(index);
+        undecided_--;
+        set_bomb(index, mine);
+    }
+
+    // sequential sampling without replacement, so the mine count always
+    // stays reachable.
+    bool draw()
+    {
+        return static_cast<int>(random_() % undecided_) < init_bombs_ - placed_;
+    }
+
+    // mines proven through the mine count alone may not be decided yet;
+    // they have to be before the count is moved around.
+    void settle_flags()
+    {
+        flagged_.for_each([this](int index) {
+            if (!decided_.test(index))
+            {
+                place(index, true);
+            }
+        });
+    }
+
+    static bool touches_number(const SolverState &state, int index)
+    {
+        for (auto next : state.board().neighbors(index))
+        {
+            if (state.revealed().test(next))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void decide_around(int index)
+    {
+        if (!decided_.test(index))
+        {
+            place(index, false);
+        }
+        for (auto next : neighbors(index))
+        {
+            if (!decided_.test(next))
+            {
+                place(next, draw());
+            }
+        }
+    }
+
+public:
+    ConstructionBoard(int width, int height, int n_bombs, const std::vector<int> &excludes, Seed seed)
+        : Board(width, height, n_bombs, false), random_(seed), decided_(width * height), undecided_(width * height)
+    {
+        for (auto ex : excludes)
+        {
+            place(ex, false);
+        }
+    }
+
+    // the flood fill of Board::open_cell4, deciding each cell's neighbors
+    // before its number is read.
+    int open_cell(int index) override
     {
-        int bombs = 0;
-        for (auto dir : dirs)
+        revealed_.clear();
+        if (opened_.test(index) || flagged_.test(index))
+        {
+            return 0;
+        }
+        decide_around(index);
+        if (bombs_.test(index))
+        {
+            failed_ = true;
+            return 0;
+        }
+        opened_.set(index);
+        revealed_.push_back(index);
+        for (std::size_t head = 0; head < revealed_.size(); head++)
         {
-            auto index = get_cell_index(i, dir);
-            if (index.has_value() && cells_.at(index.value()).has_bomb())
+            const auto current = revealed_[head];
+            if (neighbor_bombs(current) > 0)
             {
-                bombs++;
+                continue;
+            }
+            for (auto next : neighbors(current))
+            {
+                if (!opened_.test(next) && !flagged_.test(next))
+                {
+                    decide_around(next);
+                    opened_.set(next);
+                    revealed_.push_back(next);
+                }
             }
         }
-        cells_[i].set_neighbor_bombs(bombs);
-    }
-}
-
-std::optional<int>
-Board::get_cell_index(int base, Direction direction)
-{
-    auto tmp = from_index(base);
-    int column = tmp.first;
-    int row = tmp.second;
-    switch (direction)
-    {
-    case Direction::LeftUp:
-        if (column <= 0 || row <= 0)
-            return std::optional<int>();
-        return from_point(column - 1, row - 1);
-    case Direction::Up:
-        if (row <= 0)
-            return std::optional<int>();
-        return from_point(column, row - 1);
-    case Direction::RightUp:
-        if (column >= width_ - 1 || row <= 0)
-            return std::optional<int>();
-        return from_point(column + 1, row - 1);
-    case Direction::Left:
-        if (column <= 0)
-            return std::optional<int>();
-        return from_point(column - 1, row);
-    case Direction::Right:
-        if (column >= width_ - 1)
-            return std::optional<int>();
-        return from_point(column + 1, row);
-    case Direction::LeftDown:
-        if (column <= 0 || row >= height_ - 1)
-            return std::optional<int>();
-        return from_point(column - 1, row + 1);
-    case Direction::Down:
-        if (row >= height_ - 1)
-            return std::optional<int>();
-        return from_point(column, row + 1);
-    case Direction::RightDown:
-        if (column >= width_ - 1 || row >= height_ - 1)
-            return std::optional<int>();
-        return from_point(column + 1, row + 1);
-    }
-    throw std::logic_error("unreachable");
+        return static_cast<int>(revealed_.size());
+    }
+    using Board::open_cell;
+
+    struct Rewrite
+    {
+        std::vector<int> changed;
+        // a mine the solver knew about was made safe, so what it knows
+        // has to be worked out again from the opened cells.
+        bool replay = false;
+    };
+
+    // Makes the unknown neighbors of a random revealed number all mines or
+    // all safe, whichever changes fewer of them. With no such number, known
+    // mines wall the unknown cells off, and one of them is made safe. The
+    // mine count is kept by the cells not decided yet, or failing that by
+    // flipping other cells the solver does not know, those away from the
+    // revealed numbers first. Nothing changes if the count cannot be kept.
+    Rewrite force(const SolverState &state)
+    {
+        settle_flags();
+        Rewrite rewrite;
+
+        std::vector<int> numbers;
+        state.frontier().for_each([&](int cell) { numbers.push_back(cell); });
+        std::vector<int> cells;
+        BitPlane picked(get_total_cells());
+        auto mine = false;
+        int mines = 0;
+        int safe = 0;
+        if (!numbers.empty())
+        {
+            const auto pick = numbers[random_() % numbers.size()];
+            for (auto next : neighbors(pick))
+            {
+                if (state.is_unknown(next))
+                {
+                    cells.push_back(next);
+                    picked.set(next);
+                    mines += bombs_.test(next) ? 1 : 0;
+                }
+            }
+            safe = static_cast<int>(cells.size()) - mines;
+            mine = safe < mines || (safe == mines && random_() % 2 == 0);
+        }
+        else
+        {
+            std::vector<int> walls;
+            state.mine().for_each([&](int cell) {
+                for (auto next : neighbors(cell))
+                {
+                    if (state.is_unknown(next))
+                    {
+                        walls.push_back(cell);
+                        break;
+                    }
+                }
+            });
+            if (walls.empty())
+            {
+                return rewrite;
+            }
+            cells.push_back(walls[random_() % walls.size()]);
+            picked.set(cells.front());
+            mines = 1;
+            rewrite.replay = true;
+        }
+
+        // mines the undecided cells have to take over (or give up, if
+        // negative), and what they cannot.
+        const auto remaining = init_bombs_ - placed_ + (mine ? -safe : mines);
+        const auto excess = remaining < 0 ? remaining : std::max(0, remaining - undecided_);
+        std::vector<int> flips;
+        if (excess != 0)
+        {
+            const auto to_mine = excess > 0;
+            std::vector<int> inner;
+            std::vector<int> outer;
+            for (auto i = 0; i < get_total_cells(); i++)
+            {
+                if (decided_.test(i) && state.is_unknown(i) && !picked.test(i) && bombs_.test(i) != to_mine)
+                {
+                    (touches_number(state, i) ? outer : inner).push_back(i);
+                }
+            }
+            const auto needed = static_cast<std::size_t>(to_mine ? excess : -excess);
+            if (inner.size() + outer.size() < needed)
+            {
+                return Rewrite();
+            }
+            // a partial shuffle of each picks the cells to flip.
+            for (auto *pool : {&inner, &outer})
+            {
+                for (std::size_t k = 0; k < pool->size() && flips.size() < needed; k++)
+                {
+                    std::swap((*pool)[k], (*pool)[k + random_() % (pool->size() - k)]);
+                    flips.push_back((*pool)[k]);
+                }
+            }
+        }
+
+        for (auto cell : cells)
+        {
+            if (bombs_.test(cell) != mine)
+            {
+                set_bomb(cell, mine);
+                rewrite.changed.push_back(cell);
+            }
+        }
+        for (auto cell : flips)
+        {
+            set_bomb(cell, !bombs_.test(cell));
+            rewrite.changed.push_back(cell);
+        }
+        if (rewrite.replay)
+        {
+            // the flags are the old solver's; a new one sets its own.
+            flagged_.clear();
+        }
+        return rewrite;
+    }
+
+    // places the mines still missing: first on flagged cells, which the
+    // solver can only have proven through the mine count, then at random.
+    void fill()
+    {
+        settle_flags();
+        for (auto i = 0; i < get_total_cells(); i++)
+        {
+            if (!decided_.test(i))
+            {
+                place(i, draw());
+            }
+        }
+    }
+};
+
+}
+
+void Board::setup_cells_constructive(int width, int height, int n_bombs, const std::vector<int> &excludes, Seed seed)
+{
+    ConstructionBoard construction(width, height, n_bombs, excludes, seed);
+    for (auto ex : excludes)
+    {
+        construction.open_cell(ex);
+    }
+
+    // only the local rules: every rewrite is followed by another run until
+    // the solver is stuck, and the global stages would redo the whole
+    // frontier each time. The stronger check afterwards is cheap by
+    // comparison, since it runs once. A replay starts from the cells opened
+    // so far, not from the first click.
+    IgnoreSteps cb;
+    const auto max_rewrites = std::max(MIN_REWRITES, width * height / CELLS_PER_REWRITE);
+    auto rewrites = 0;
+    auto replay = true;
+    while (replay)
+    {
+        replay = false;
+        auto ai = MineAI::player(construction);
+        ai.stages() = MineAI::PATTERNS;
+        auto result = ai.run(cb);
+        while (result == SolveResult::Stuck && rewrites < max_rewrites)
+        {
+            rewrites++;
+            const auto rewrite = construction.force(ai.knowledge());
+            if (rewrite.changed.empty())
+            {
+                break;
+            }
+            if (rewrite.replay)
+            {
+                replay = true;
+                break;
+            }
+            ai.mines_moved(rewrite.changed);
+            result = ai.run(cb);
+        }
+    }
+    construction.fill();
+
+    resize_planes(width * height);
+    bombs_ = construction.bombs();
+    // not what setup_cells would place for this seed.
+    seed_.reset();
+    first_click_ = -1;
+    exclusion_radius_ = 0;
+}
+
+void Board::setup_cells_around(int width, int height, int n_bombs, int first_click, int radius, Seed seed)
+{
+    setup_cells(width, height, n_bombs, cells_around(first_click, radius), seed);
+    seed_ = seed;
+    first_click_ = first_click;
+    exclusion_radius_ = radius;
+}
+
+std::vector<int> Board::cells_around(int index, int radius) const
+{
+    const auto center = from_index(index);
+    std::vector<int> cells;
+    for (auto row = std::max(0, center.second - radius); row <= std::min(height_ - 1, center.second + radius); row++)
+    {
+        for (auto column = std::max(0, center.first - radius); column <= std::min(width_ - 1, center.first + radius); column++)
+        {
+            cells.push_back(from_point(column, row));
+        }
+    }
+    return cells;
+}
+
+Board Board::from_id(const BoardId &id)
+{
+    Board board(id.width, id.height, id.bombs, false);
+    if (id.first_click >= 0)
+    {
+        board.setup_cells_around(id.width, id.height, id.bombs, id.first_click, id.exclusion_radius, id.seed);
+    }
+    else
+    {
+        board.setup_cells(id.width, id.height, id.bombs, std::vector<int>(), id.seed);
+    }
+    board.build_neighbor_map();
+    if (id.first_click >= 0)
+    {
+        board.open_cell(id.first_click);
+    }
+    return board;
+}
+
+std::optional<BoardId> Board::board_id() const
+{
+    if (!seed_.has_value())
+    {
+        return std::optional<BoardId>();
+    }
+    BoardId id;
+    id.width = width_;
+    id.height = height_;
+    id.bombs = init_bombs_;
+    id.seed = seed_.value();
+    id.first_click = first_click_;
+    id.exclusion_radius = exclusion_radius_;
+    return id;
+}
+
+void Board::resize_planes(int cells)
+{
+    bombs_.resize(cells);
+    opened_.resize(cells);
+    flagged_.resize(cells);
+    neighbor_counts_.assign((cells + 1) / 2, 0);
+}
+
+void Board::set_neighbor_bombs(int index, int bombs)
+{
+    const int shift = (index & 1) << 2;
+    auto &packed = neighbor_counts_[index >> 1];
+    packed = static_cast<std::uint8_t>((packed & ~(0xf << shift)) | (bombs << shift));
+}
+
+void Board::build_neighbor_map()
+{
+    // only bomb cells contribute, so walk the bomb plane instead of every cell.
+    std::fill(neighbor_counts_.begin(), neighbor_counts_.end(), 0);
+    bombs_.for_each([this](int bomb) {
+        for (auto index : neighbors(bomb))
+        {
+            set_neighbor_bombs(index, neighbor_bombs(index) + 1);
+        }
+    });
 }
 
 Board::Point
 Board::from_index(int index) const
 {
-    return std::make_pair<int, int>(index % width_, index / height_);
+    return std::make_pair<int, int>(index % width_, index / width_);
 }
 
 int Board::from_point(const Board::Point &point) const
@@ -272,7 +790,7 @@ Board::show_game_state(std::ostream &os, bool disclose_bombs) const
         {
             os << '\n';
         }
-        os << char_of_cell(cells_.at(i), disclose_bombs);
+        os << char_of_cell((*this)[i], disclose_bombs);
         os << ' ';
     }
     return os;
@@ -305,60 +823,68 @@ char Board::char_of_cell(const Cell &c, bool disclose_bomb)
     return 'O';
 }
 
-void Board::open_cell(const Point &point)
+int Board::open_cell(const Point &point)
 {
-    open_cell(from_point(point));
+    return open_cell(from_point(point));
 }
 
-void Board::open_cell(int index)
+int Board::open_cell(int index)
 {
-    if (cells_.at(index).has_bomb())
+    if (bombs_.test(index))
     {
+        revealed_.clear();
         failed_ = true;
-        return;
+        return 0;
     }
-    open_cell4(index);
+    return open_cell4(index);
 }
 
-void Board::open_cell(int column, int row)
+int Board::open_cell(int column, int row)
 {
-    open_cell(from_point(column, row));
+    return open_cell(from_point(column, row));
 }
 
-void Board::open_cell4(int index)
+int Board::open_cell4(int index)
 {
-    auto &cell = cells_[index];
-    if (cell.has_bomb() || cell.opened() || cell.flagged())
+    revealed_.clear();
+    if (bombs_.test(index) || opened_.test(index) || flagged_.test(index))
     {
         // do not disclose.
-        return;
+        return 0;
     }
 
-    cell.state() = CellState::Opened;
+    opened_.set(index);
+    revealed_.push_back(index);
 
-    if (cell.neighbor_bombs() > 0)
+    // revealed_ doubles as the queue, so the fill needs no recursion and no
+    // allocation once the buffer has grown.
+    for (std::size_t head = 0; head < revealed_.size(); head++)
     {
-        // disclose this cell, but no neighbor cells.
-        return;
-    }
+        const auto current = revealed_[head];
+        if (neighbor_bombs(current) > 0)
+        {
+            // disclose this cell, but no neighbor cells.
+            continue;
+        }
 
-    std::array<Direction, 8> dirs = {
-        Direction::Up, Direction::Left, Direction::Right, Direction::Down, Direction::LeftUp, Direction::RightUp, Direction::LeftDown, Direction::RightDown};
-    for (auto dir : dirs)
-    {
-        auto next_index = get_cell_index(index, dir);
-        if (next_index.has_value())
+        for (auto next_index : neighbors(current))
         {
-            open_cell4(next_index.value());
+            if (!bombs_.test(next_index) && !opened_.test(next_index) && !flagged_.test(next_index))
+            {
+                opened_.set(next_index);
+                revealed_.push_back(next_index);
+            }
         }
     }
+    return static_cast<int>(revealed_.size());
 }
 
 bool Board::cleared() const
 {
-    for (const auto &cell : cells_)
+    // cleared iff every cell is either a bomb or opened, but not both.
+    for (auto w = 0; w < bombs_.word_count(); w++)
     {
-        if ((!cell.has_bomb() && !cell.opened()) || (cell.has_bomb() && cell.opened()))
+        if ((bombs_.word(w) ^ opened_.word(w)) != bombs_.mask(w))
         {
             return false;
         }
@@ -368,22 +894,35 @@ bool Board::cleared() const
 
 void Board::initAll()
 {
-    cells_.clear();
+    resize_planes(0);
+}
+
+void Board::move_bomb(int from, int to)
+{
+    if (!bombs_.test(from) || bombs_.test(to))
+    {
+        throw std::logic_error("move_bomb needs a bomb at from and none at to");
+    }
+    bombs_.reset(from);
+    for (auto index : neighbors(from))
+    {
+        set_neighbor_bombs(index, neighbor_bombs(index) - 1);
+    }
+    bombs_.set(to);
+    for (auto index : neighbors(to))
+    {
+        set_neighbor_bombs(index, neighbor_bombs(index) + 1);
+    }
+    seed_.reset();
+    first_click_ = -1;
+    exclusion_radius_ = 0;
 }
 
 void Board::toggle_flag(int index)
 {
-    auto &cell = cells_[index];
-    switch (cell.state())
+    if (!opened_.test(index))
     {
-    case CellState::Opened:
-        return;
-    case CellState::Closed:
-        cell.state() = CellState::Flagged;
-        break;
-    case CellState::Flagged:
-        cell.state() = CellState::Closed;
-        break;
+        flagged_.assign(index, !flagged_.test(index));
     }
 }
 
@@ -399,30 +938,102 @@ void Board::toggle_flag(int column, int row)
 
 void LazyInitBoard::generateActualBoard(int excludeCellIndex, bool openCell)
 {
-    auto self = *this;
-    BoardBuilder builder;
-    auto *newBoard = dynamic_cast<LazyInitBoard *>(builder.generateLogicalBoard([&self, excludeCellIndex]() {
+    if (!take_pooled(excludeCellIndex))
+    {
+        BoardBuilder builder;
+        auto newBoard = generate(excludeCellIndex, builder /* unlimited attempts */);
+        if (!newBoard)
+        {
+            std::cerr << "could not generate new board" << std::endl;
+            return;
+        }
+        *this = std::move(*newBoard);
+    }
+
+    // the clicked cell has already been opened; its reveal list came along with the move.
+    if (openCell && !opened_.test(excludeCellIndex))
+    {
+        this->open_cell(excludeCellIndex);
+    }
+}
+
+std::unique_ptr<LazyInitBoard> LazyInitBoard::generate(int excludeCellIndex, BoardBuilder &builder, std::optional<int> maxAttempts) const
+{
+    const auto &self = *this;
+    const auto radius = opening_radius_at(excludeCellIndex);
+    std::atomic<long long> copies{0};
+    auto *newBoard = dynamic_cast<LazyInitBoard *>(builder.generateLogicalBoard([&self, &copies, excludeCellIndex, radius](Seed attempt_seed) {
+        copies++;
         auto *b = new LazyInitBoard(self);
         b->initAll();
-        b->setup_cells(self.width_, self.height_, self.init_bombs_, std::vector<int>{excludeCellIndex});
+        if (self.generation == Generation::Constructive)
+        {
+            b->setup_cells_constructive(self.width_, self.height_, self.init_bombs_, self.cells_around(excludeCellIndex, radius), attempt_seed);
+        }
+        else
+        {
+            b->setup_cells_around(self.width_, self.height_, self.init_bombs_, excludeCellIndex, radius, attempt_seed);
+        }
         b->build_neighbor_map();
         b->beforeInit = false;
         b->open_cell(excludeCellIndex);
         return b;
     },
-                                                                                std::optional<int>() /* unlimited */));
+                                                                                maxAttempts, base_seed));
+    if (newBoard != nullptr)
+    {
+        newBoard->report.metrics = builder.generation_metrics();
+        newBoard->report.metrics.board_copies += copies;
+        newBoard->report.seconds = builder.generation_seconds();
+        newBoard->report.attempts = builder.attempt_count();
+        newBoard->report.repairs = builder.repair_count();
+    }
+    return std::unique_ptr<LazyInitBoard>(newBoard);
+}
 
-    if (newBoard == nullptr)
+int LazyInitBoard::opening_radius_at(int index) const
+{
+    auto radius = std::max(0, opening_radius);
+    while (radius > 0 && init_bombs_ > get_total_cells() - static_cast<int>(cells_around(index, radius).size()))
     {
-        std::cerr << "could not generate new board" << std::endl;
-        return;
+        radius--;
     }
-    *this = std::move(*newBoard);
-    delete newBoard;
+    return radius;
+}
 
-    if (openCell)
+bool LazyInitBoard::take_pooled(int excludeCellIndex)
+{
+    if (!ai_check || base_seed.has_value())
     {
-        this->open_cell(excludeCellIndex);
+        return false;
+    }
+    auto mines = BoardPool::shared().take(BoardSpec{width_, height_, init_bombs_, opening_radius, generation, StrategyRegistry::default_name()}, excludeCellIndex);
+    if (!mines.has_value())
+    {
+        return false;
+    }
+
+    initAll();
+    resize_planes(get_total_cells());
+    for (auto mine : mines.value())
+    {
+        bombs_.set(mine);
+    }
+    // mapped from another board, so there is no seed to regenerate it from.
+    seed_.reset();
+    first_click_ = -1;
+    exclusion_radius_ = 0;
+    build_neighbor_map();
+    beforeInit = false;
+    open_cell(excludeCellIndex);
+    return true;
+}
+
+void LazyInitBoard::warm_up() const
+{
+    if (ai_check && !base_seed.has_value())
+    {
+        BoardPool::shared().want(BoardSpec{width_, height_, init_bombs_, opening_radius, generation, StrategyRegistry::default_name()});
     }
 }
 
@@ -432,18 +1043,18 @@ void LazyInitBoard::initAll()
     beforeInit = true;
 }
 
-LazyInitBoard::LazyInitBoard(int width, int height, int n_bombs, bool ai_check)
-    : Board(width, height, n_bombs, false), ai_check(ai_check)
+LazyInitBoard::LazyInitBoard(int width, int height, int n_bombs, bool ai_check, std::optional<Seed> seed, Generation generation, int opening_radius)
+    : Board(width, height, n_bombs, false), ai_check(ai_check), base_seed(seed), generation(generation), opening_radius(opening_radius)
 {
 }
 
 LazyInitBoard::LazyInitBoard(const LazyInitBoard &lb)
-    : Board(lb), beforeInit(lb.beforeInit)
+    : Board(lb), beforeInit(lb.beforeInit), ai_check(lb.ai_check), base_seed(lb.base_seed), generation(lb.generation), opening_radius(lb.opening_radius), report(lb.report)
 {
 }
 
 LazyInitBoard::LazyInitBoard(LazyInitBoard &&lb)
-    : Board(std::move(lb)), beforeInit(lb.beforeInit)
+    : Board(std::move(lb)), beforeInit(lb.beforeInit), ai_check(lb.ai_check), base_seed(lb.base_seed), generation(lb.generation), opening_radius(lb.opening_radius), report(lb.report)
 {
 }
 
@@ -455,35 +1066,46 @@ LazyInitBoard &LazyInitBoard::operator=(const LazyInitBoard &lb)
 {
     Board::operator=(lb);
     beforeInit = lb.beforeInit;
+    ai_check = lb.ai_check;
+    base_seed = lb.base_seed;
+    generation = lb.generation;
+    opening_radius = lb.opening_radius;
+    report = lb.report;
     return *this;
 }
 
 LazyInitBoard &LazyInitBoard::operator=(LazyInitBoard &&lb)
 {
     beforeInit = lb.beforeInit;
+    ai_check = lb.ai_check;
+    base_seed = lb.base_seed;
+    generation = lb.generation;
+    opening_radius = lb.opening_radius;
+    report = lb.report;
     Board::operator=(std::move(lb));
     return *this;
 }
 
-void LazyInitBoard::open_cell(const Board::Point &point)
+int LazyInitBoard::open_cell(const Board::Point &point)
 {
-    open_cell(from_point(point));
+    return open_cell(from_point(point));
 }
 
-void LazyInitBoard::open_cell(int index)
+int LazyInitBoard::open_cell(int index)
 {
     if (beforeInit)
     {
         generateActualBoard(index, true);
         beforeInit = false;
+        return static_cast<int>(revealed_.size());
     }
     else
     {
-        Board::open_cell(index);
+        return Board::open_cell(index);
     }
 }
 
-void LazyInitBoard::open_cell(int column, int row)
+int LazyInitBoard::open_cell(int column, int row)
 {
-    open_cell(from_point(column, row));
+    return open_cell(from_point(column, row));
 }
@@ -1,37 +1,115 @@
 #pragma once
 
+#include "bitplane.h"
+#include "solvermetrics.h"
+#include <cstdint>
+#include <memory>
 #include <utility>
 #include <vector>
 #include <iostream>
 #include <optional>
+#include <stdexcept>
+#include <string>
 
 namespace minesweeper {
 
+class BoardBuilder;
+
 enum class CellState {
     Opened,
     Closed,
     Flagged
 };
 
-enum class Direction {
-    LeftUp,
-    Up,
-    RightUp,
-    Left,
-    Right,
-    LeftDown,
-    Down,
-    RightDown
+// how a generated board gets its mines.
+enum class Generation {
+    // uniformly at random, regenerated or repaired until a solver clears it.
+    Rejection,
+    // decided while a solver plays it, see Board::setup_cells_constructive.
+    Constructive
 };
 
 class Cell;
 class Board;
 
+using Seed = std::uint64_t;
+
+// splitmix64 step; derives independent RNG streams (e.g. one per generation
+// attempt) from a single base seed.
+inline Seed derive_seed(Seed base, std::uint64_t stream)
+{
+    Seed z = base + (stream + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+Seed random_seed();
+
+// Everything needed to regenerate a board exactly.
+// Text form: "<width>x<height>-<bombs>-<seed in hex>[-<first click>[r<radius>]]".
+struct BoardId {
+    int width = 0;
+    int height = 0;
+    int bombs = 0;
+    Seed seed = 0;
+    int first_click = -1;
+    // no mines within this many steps of the first click.
+    int exclusion_radius = 0;
+
+    std::string to_string() const;
+    static std::optional<BoardId> parse(const std::string& text);
+};
+
+// Contiguous view of a cell's neighbor indices.
+class NeighborRange {
+    const int* begin_;
+    const int* end_;
+
+public:
+    NeighborRange(const int* begin, const int* end)
+        : begin_(begin)
+        , end_(end)
+    {
+    }
+
+    const int* begin() const { return begin_; }
+    const int* end() const { return end_; }
+    int size() const { return static_cast<int>(end_ - begin_); }
+};
+
+// Neighbor indices of every cell for one board size, laid out with a fixed
+// stride of 8 plus a per-cell count. Tables are shared between boards of the
+// same size; obtain one through NeighborTable::get.
+class NeighborTable {
+    int width_;
+    int height_;
+    std::vector<int> indices_;
+    std::vector<std::uint8_t> counts_;
+
+public:
+    static constexpr int STRIDE = 8;
+
+    NeighborTable(int width, int height);
+
+    static std::shared_ptr<const NeighborTable> get(int width, int height);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    NeighborRange neighbors(int index) const
+    {
+        const int* first = indices_.data() + index * STRIDE;
+        return NeighborRange(first, first + counts_[index]);
+    }
+};
+
+// Read-only snapshot of a single cell.
+// Board keeps its cells as bit planes; mutate them through Board itself.
 class Cell {
     bool has_bomb_;
     CellState state_;
     int neighbor_bombs_ = 0;
-    bool assumption = false;
 
 public:
     Cell()
@@ -39,44 +117,20 @@ public:
     {
     }
 
-    Cell(bool has_bomb, CellState state = CellState::Closed)
+    Cell(bool has_bomb, CellState state = CellState::Closed, int neighbor_bombs = 0)
         : has_bomb_(has_bomb)
         , state_(state)
+        , neighbor_bombs_(neighbor_bombs)
     {
     }
 
-    Cell(const Cell& cell)
-        : has_bomb_(cell.has_bomb_)
-        , state_(cell.state_)
-        , neighbor_bombs_(cell.neighbor_bombs_)
-        , assumption(cell.assumption)
-    {
-    }
-
-    Cell& operator=(const Cell& cell)
-    {
-        has_bomb_ = cell.has_bomb_;
-        state_ = cell.state_;
-        neighbor_bombs_ = cell.neighbor_bombs_;
-        assumption = cell.assumption;
-        return *this;
-    }
-
-    bool& has_bomb() { return has_bomb_; }
-    const bool& has_bomb() const { return has_bomb_; }
-
-    CellState& state() { return state_; }
-    const CellState& state() const { return state_; }
-
-    void set_neighbor_bombs(int bombs) { neighbor_bombs_ = bombs; }
+    bool has_bomb() const { return has_bomb_; }
+    CellState state() const { return state_; }
     int neighbor_bombs() const { return neighbor_bombs_; }
 
     bool opened() const { return state_ == CellState::Opened; }
     bool closed() const { return state_ == CellState::Closed; }
     bool flagged() const { return state_ == CellState::Flagged; }
-
-    bool& is_assumption() { return assumption; }
-    const bool& is_assumption() const { return assumption; }
 };
 
 class Board {
@@ -84,24 +138,51 @@ protected:
     int width_;
     int height_;
     int init_bombs_;
-    std::vector<Cell> cells_;
     bool failed_ = false;
+    std::shared_ptr<const NeighborTable> neighbors_;
+    std::optional<Seed> seed_;
+    int first_click_ = -1;
+    int exclusion_radius_ = 0;
+
+    BitPlane bombs_;
+    BitPlane opened_;
+    BitPlane flagged_;
+    // two 4-bit neighbor bomb counts per byte.
+    std::vector<std::uint8_t> neighbor_counts_;
+
+    void resize_planes(int cells);
+    void set_neighbor_bombs(int index, int bombs);
 
     void setup_cells(int width, int height, int n_bombs);
     void setup_cells(int width, int height, int n_bombs, const std::vector<int>& excludes);
+    void setup_cells(int width, int height, int n_bombs, const std::vector<int>& excludes, Seed seed);
+    // setup_cells with no mines within radius steps of first_click.
+    void setup_cells_around(int width, int height, int n_bombs, int first_click, int radius, Seed seed);
+    // places the mines while MineAI's local rules play the board from
+    // excludes, deciding each cell only once a revealed number depends
+    // on it and rewriting the cells around a number whenever the solver gets
+    // stuck. The number of rewrites is bounded, and after each one the
+    // solver only rechecks the numbers it changed instead of playing again
+    // from excludes. A rewrite can change numbers earlier deductions used,
+    // so the board still needs a check. Like setup_cells, leaves the
+    // neighbor map to build_neighbor_map().
+    void setup_cells_constructive(int width, int height, int n_bombs, const std::vector<int>& excludes, Seed seed);
     void build_neighbor_map();
     virtual void initAll();
 
     static char char_of_cell(const Cell& c, bool disclose_bomb);
 
-    void open_cell4(int index);
+    // cells opened by the last open_cell call; also the flood fill work queue.
+    std::vector<int> revealed_;
+
+    int open_cell4(int index);
 
 public:
     using Point = std::pair<int, int>;
 
-    Board(int width, int height, int n_bombs, bool initialize = true);
-    Board(int width, int height, int n_bombs, const std::vector<int>& excludes, bool ai_check = false);
-    Board(int width, int height, int n_bombs, const std::vector<Point>& excludes, bool ai_check = false);
+    Board(int width, int height, int n_bombs, bool initialize = true, std::optional<Seed> seed = std::nullopt);
+    Board(int width, int height, int n_bombs, const std::vector<int>& excludes, bool ai_check = false, std::optional<Seed> seed = std::nullopt);
+    Board(int width, int height, int n_bombs, const std::vector<Point>& excludes, bool ai_check = false, std::optional<Seed> seed = std::nullopt);
     Board(const Board& board);
     Board(Board&& board);
     virtual ~Board();
@@ -109,7 +190,16 @@ public:
     Board& operator=(const Board& board);
     Board& operator=(Board&& board);
 
-    std::optional<int> get_cell_index(int base, Direction direction);
+    // regenerates the board described by id, with its first click opened.
+    static Board from_id(const BoardId& id);
+
+    // empty until the mines have been placed from a known seed, and for
+    // boards generated around more than one excluded cell.
+    std::optional<BoardId> board_id() const;
+
+    NeighborRange neighbors(int index) const { return neighbors_->neighbors(index); }
+    // index and every cell within radius king moves of it.
+    std::vector<int> cells_around(int index, int radius) const;
 
     Point from_index(int index) const;
     int from_point(const Point& point) const;
@@ -122,21 +212,60 @@ public:
     std::ostream& operator<<(std::ostream& os) const;
     std::ostream& show_game_state(std::ostream& os, bool disclose_bombs) const;
 
-    virtual void open_cell(const Point& point);
-    virtual void open_cell(int index);
-    virtual void open_cell(int column, int row);
+    // return the number of newly opened cells; see last_revealed() for which.
+    virtual int open_cell(const Point& point);
+    virtual int open_cell(int index);
+    virtual int open_cell(int column, int row);
+
+    const std::vector<int>& last_revealed() const { return revealed_; }
 
     bool failed() const { return failed_; }
     bool cleared() const;
 
-    Cell& operator[](int index) { return cells_[index]; }
-    const Cell& operator[](int index) const { return cells_.at(index); }
-    Cell& operator[](const Point& point) { return cells_[from_point(point)]; }
-    const Cell& operator[](const Point& point) const
+    // throw std::out_of_range for cells off the board, like the vector
+    // lookup they replaced; the other accessors take the index on trust.
+    Cell operator[](int index) const
     {
-        return cells_.at(from_point(point));
+        if (index < 0 || index >= get_total_cells()) {
+            throw std::out_of_range("cell index out of range");
+        }
+        return Cell(has_bomb(index), state(index), neighbor_bombs(index));
+    }
+    Cell operator[](const Point& point) const
+    {
+        if (point.first < 0 || point.first >= width_ || point.second < 0 || point.second >= height_) {
+            throw std::out_of_range("cell point out of range");
+        }
+        return (*this)[from_point(point)];
+    }
+
+    bool has_bomb(int index) const { return bombs_.test(index); }
+    CellState state(int index) const
+    {
+        if (opened_.test(index)) {
+            return CellState::Opened;
+        }
+        return flagged_.test(index) ? CellState::Flagged : CellState::Closed;
+    }
+    int neighbor_bombs(int index) const
+    {
+        return (neighbor_counts_[index >> 1] >> ((index & 1) << 2)) & 0xf;
     }
 
+    void set_has_bomb(int index, bool has_bomb) { bombs_.assign(index, has_bomb); }
+    // moves the bomb at from to the empty cell to, keeping the numbers up to
+    // date. The board no longer matches its seed, so board_id() becomes empty.
+    void move_bomb(int from, int to);
+    void set_state(int index, CellState state)
+    {
+        opened_.assign(index, state == CellState::Opened);
+        flagged_.assign(index, state == CellState::Flagged);
+    }
+
+    const BitPlane& bombs() const { return bombs_; }
+    const BitPlane& opened() const { return opened_; }
+    const BitPlane& flagged() const { return flagged_; }
+
     void toggle_flag(int index);
     void toggle_flag(const Point& point);
     void toggle_flag(int xIndex, int yIndex);
@@ -145,15 +274,40 @@ public:
 };
 
 class LazyInitBoard : public Board {
+    friend class BoardPool;
+
 protected:
     bool beforeInit = true;
     void generateActualBoard(int excludeCellIndex, bool openCell);
+    // a board with excludeCellIndex opened, or nullptr if builder gave up.
+    std::unique_ptr<LazyInitBoard> generate(int excludeCellIndex, BoardBuilder& builder,
+        std::optional<int> maxAttempts = std::nullopt) const;
+    // opening_radius, shrunk until the mines fit around index.
+    int opening_radius_at(int index) const;
+    // takes a board of the same size from BoardPool::shared() if one can
+    // start at excludeCellIndex.
+    bool take_pooled(int excludeCellIndex);
     bool ai_check;
+    std::optional<Seed> base_seed;
+    Generation generation;
+    int opening_radius;
+    // what the BoardBuilder behind the first click reported.
+    struct GenerationReport
+    {
+        SolverMetrics metrics;
+        double seconds = 0.0;
+        int attempts = 0;
+        int repairs = 0;
+    } report;
 
     void initAll() override;
 
 public:
-    LazyInitBoard(int width, int height, int n_bombs, bool ai_check = false);
+    // no mines are placed within opening_radius steps of the first click,
+    // so with 1 or more it always opens a region. Shrunk if the mines would
+    // not fit otherwise. 0 only keeps the first click itself safe.
+    LazyInitBoard(int width, int height, int n_bombs, bool ai_check = false, std::optional<Seed> seed = std::nullopt,
+        Generation generation = Generation::Rejection, int opening_radius = 0);
     LazyInitBoard(const LazyInitBoard& lb);
     LazyInitBoard(LazyInitBoard&& lb);
     virtual ~LazyInitBoard();
@@ -161,8 +315,22 @@ public:
     LazyInitBoard& operator=(const LazyInitBoard& lb);
     LazyInitBoard& operator=(LazyInitBoard&& lb);
 
-    virtual void open_cell(const Point& point) override;
-    virtual void open_cell(int index) override;
-    virtual void open_cell(int column, int row) override;
+    // what the BoardBuilder that generated the board on the first click
+    // reported, see its accessors of the same names; the metrics also count
+    // the boards copied for its attempts. Empty before the first click and
+    // for boards taken from BoardPool.
+    const SolverMetrics& generation_metrics() const { return report.metrics; }
+    double generation_seconds() const { return report.seconds; }
+    int attempt_count() const { return report.attempts; }
+    int repair_count() const { return report.repairs; }
+
+    // lets BoardPool::shared() start preparing boards like this one, so that
+    // the first click need not wait. Only checked boards without a fixed
+    // seed are pooled; the others are always generated on the first click.
+    void warm_up() const;
+
+    virtual int open_cell(const Point& point) override;
+    virtual int open_cell(int index) override;
+    virtual int open_cell(int column, int row) override;
 };
 }
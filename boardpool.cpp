@@ -0,0 +1,289 @@
+#include "boardpool.h"
+#include "ai.h"
+#include "componentcache.h"
+#include "strategy.h"
+#include "taskpool.h"
+#include <exception>
+#include <iostream>
+#include <random>
+#include <utility>
+
+using namespace minesweeper;
+
+namespace {
+
+// gives up on a spec after this many attempts at one board.
+constexpr int MAX_ATTEMPTS = 1000;
+
+// ends a probe once the pool is shutting down.
+struct StopWhen : public IgnoreSteps {
+    const std::atomic<bool>& stopping;
+
+    explicit StopWhen(const std::atomic<bool>& stopping)
+        : stopping(stopping)
+    {
+    }
+    bool cancelled() const override { return stopping; }
+};
+
+// the symmetries of the rectangle, as bits: 1 mirrors columns, 2 mirrors
+// rows, 4 transposes first, which only keeps the shape of square boards.
+int symmetry_count(int width, int height)
+{
+    return width == height ? 8 : 4;
+}
+
+int transform(int symmetry, int index, int width, int height)
+{
+    auto column = index % width;
+    auto row = index / width;
+    if (symmetry & 4) {
+        std::swap(column, row);
+    }
+    if (symmetry & 1) {
+        column = width - 1 - column;
+    }
+    if (symmetry & 2) {
+        row = height - 1 - row;
+    }
+    return column + row * width;
+}
+
+int inverse_transform(int symmetry, int index, int width, int height)
+{
+    auto column = index % width;
+    auto row = index / width;
+    if (symmetry & 1) {
+        column = width - 1 - column;
+    }
+    if (symmetry & 2) {
+        row = height - 1 - row;
+    }
+    if (symmetry & 4) {
+        std::swap(column, row);
+    }
+    return column + row * width;
+}
+
+}
+
+BoardPool::BoardPool(unsigned threads)
+{
+    for (unsigned i = 0; i < threads; i++) {
+        threads_.emplace_back([this] { fill(); });
+    }
+}
+
+BoardPool::~BoardPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+BoardPool& BoardPool::shared()
+{
+    // the fillers use these until they are joined, so they have to be
+    // constructed first to be destroyed after the pool.
+    TaskPool::shared();
+    ComponentCache::shared();
+    StrategyRegistry::default_name();
+
+    static BoardPool pool;
+    return pool;
+}
+
+BoardPool::Slot& BoardPool::touch(const BoardSpec& spec)
+{
+    for (auto it = slots_.begin(); it != slots_.end(); ++it) {
+        if (it->spec == spec) {
+            slots_.splice(slots_.begin(), slots_, it);
+            return slots_.front();
+        }
+    }
+    slots_.emplace_front();
+    slots_.front().spec = spec;
+    if (slots_.size() > MAX_SPECS) {
+        slots_.pop_back();
+    }
+    wake_.notify_all();
+    return slots_.front();
+}
+
+void BoardPool::want(const BoardSpec& spec)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    touch(spec);
+}
+
+std::optional<std::vector<int>> BoardPool::take(const BoardSpec& spec, int click)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = touch(spec);
+    const auto symmetries = symmetry_count(spec.width, spec.height);
+    for (auto it = slot.boards.begin(); it != slot.boards.end(); ++it) {
+        for (int symmetry = 0; symmetry < symmetries; symmetry++) {
+            if (!it->starts.test(inverse_transform(symmetry, click, spec.width, spec.height))) {
+                continue;
+            }
+            std::vector<int> mines;
+            mines.reserve(it->mines.size());
+            for (auto mine : it->mines) {
+                mines.push_back(transform(symmetry, mine, spec.width, spec.height));
+            }
+            slot.boards.erase(it);
+            wake_.notify_all();
+            return mines;
+        }
+    }
+    return std::nullopt;
+}
+
+std::size_t BoardPool::ready(const BoardSpec& spec) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& slot : slots_) {
+        if (slot.spec == spec) {
+            return slot.boards.size();
+        }
+    }
+    return 0;
+}
+
+void BoardPool::fill()
+{
+    while (true) {
+        BoardSpec spec;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            std::list<Slot>::iterator needy;
+            wake_.wait(lock, [&] {
+                if (stopping_) {
+                    return true;
+                }
+                // the most recently used spec comes first.
+                for (needy = slots_.begin(); needy != slots_.end(); ++needy) {
+                    if (!needy->failed && needy->boards.size() + needy->pending < CAPACITY) {
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (stopping_) {
+                return;
+            }
+            needy->pending++;
+            spec = needy->spec;
+        }
+
+        std::optional<PooledBoard> board;
+        try {
+            board = make(spec);
+        } catch (const std::exception& e) {
+            std::cerr << "board pool: " << e.what() << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& slot : slots_) {
+            if (slot.spec == spec) {
+                slot.pending--;
+                if (board.has_value()) {
+                    slot.boards.push_back(std::move(board.value()));
+                } else {
+                    slot.failed = true;
+                }
+                break;
+            }
+        }
+    }
+}
+
+std::optional<BoardPool::PooledBoard> BoardPool::make(const BoardSpec& spec) const
+{
+    const auto cells = spec.width * spec.height;
+    std::mt19937_64 random(random_seed());
+    const auto click = static_cast<int>(random() % static_cast<std::uint64_t>(cells));
+
+    const LazyInitBoard blank(spec.width, spec.height, spec.bombs, true, std::nullopt, spec.generation, spec.opening_radius);
+    BoardBuilder builder;
+    builder.check_strategy() = spec.strategy;
+    // leave the shared task pool to the game in the foreground, and the
+    // terminal too.
+    builder.workers() = 1;
+    builder.parallel_branches() = false;
+    builder.quiet() = true;
+    builder.stop_condition() = [this] { return stopping_.load(); };
+    auto board = blank.generate(click, builder, MAX_ATTEMPTS);
+    if (!board) {
+        return std::nullopt;
+    }
+
+    PooledBoard pooled;
+    board->bombs().for_each([&pooled](int mine) { pooled.mines.push_back(mine); });
+
+    // every cell of a zero region opens the whole region, so one probe from
+    // a fresh copy decides them all; a numbered cell only opens itself.
+    const auto solver = StrategyRegistry::create(spec.strategy);
+    if (!solver) {
+        return std::nullopt;
+    }
+    if (auto* configurable = dynamic_cast<MineAIStrategy*>(solver.get())) {
+        configurable->parallel_branches() = false;
+    }
+    const auto solves_from = [&](int start) {
+        Board probe(*board);
+        for (auto index = 0; index < cells; index++) {
+            probe.set_state(index, CellState::Closed);
+        }
+        probe.open_cell(start);
+        StopWhen cb(stopping_);
+        return solver->solve(probe, cb).result == SolveResult::Solved;
+    };
+    const auto valid_start = [&](int index) {
+        for (auto near : board->cells_around(index, blank.opening_radius_at(index))) {
+            if (board->has_bomb(near)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    pooled.starts.resize(cells);
+    if (board->neighbor_bombs(click) != 0 && valid_start(click) && solves_from(click)) {
+        pooled.starts.set(click);
+    }
+    BitPlane seen(cells);
+    std::vector<int> region;
+    for (auto origin = 0; origin < cells; origin++) {
+        if (seen.test(origin) || board->has_bomb(origin) || board->neighbor_bombs(origin) != 0) {
+            continue;
+        }
+        region.assign(1, origin);
+        seen.set(origin);
+        for (std::size_t i = 0; i < region.size(); i++) {
+            for (auto next : board->neighbors(region[i])) {
+                if (!seen.test(next) && !board->has_bomb(next) && board->neighbor_bombs(next) == 0) {
+                    seen.set(next);
+                    region.push_back(next);
+                }
+            }
+        }
+        if (!solves_from(origin)) {
+            continue;
+        }
+        for (auto index : region) {
+            if (valid_start(index)) {
+                pooled.starts.set(index);
+            }
+        }
+    }
+    if (stopping_) {
+        return std::nullopt;
+    }
+    return pooled;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "bitplane.h"
+#include "board.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace minesweeper {
+
+// the settings of a LazyInitBoard that its generated boards depend on.
+struct BoardSpec {
+    int width = 0;
+    int height = 0;
+    int bombs = 0;
+    int opening_radius = 0;
+    Generation generation = Generation::Rejection;
+    // the registered strategy the boards are checked with; a board another
+    // one certified may be one this one gets stuck on.
+    std::string strategy;
+
+    bool operator==(const BoardSpec& other) const
+    {
+        return std::tie(width, height, bombs, opening_radius, generation, strategy)
+            == std::tie(other.width, other.height, other.bombs, other.opening_radius, other.generation, other.strategy);
+    }
+};
+
+// Checked boards generated ahead of time by background threads, kept for
+// the few most recently used specs. Each board remembers the first clicks
+// it is valid for: those the spec's strategy clears the board from with
+// nothing else opened. The rotations and reflections that keep the board's
+// shape then map it onto whichever cell the player actually clicks.
+class BoardPool {
+public:
+    // boards kept ready per spec.
+    static constexpr std::size_t CAPACITY = 4;
+    // specs kept; the least recently used one is dropped.
+    static constexpr std::size_t MAX_SPECS = 3;
+
+private:
+    struct PooledBoard {
+        std::vector<int> mines;
+        BitPlane starts;
+    };
+
+    struct Slot {
+        BoardSpec spec;
+        std::deque<PooledBoard> boards;
+        // boards being generated for it right now.
+        std::size_t pending = 0;
+        // set once a board could not be made; nothing more is tried.
+        bool failed = false;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    // most recently used first.
+    std::list<Slot> slots_;
+    std::vector<std::thread> threads_;
+    // also read by make() without the lock, to give up on a board.
+    std::atomic<bool> stopping_ { false };
+
+    Slot& touch(const BoardSpec& spec);
+    void fill();
+    std::optional<PooledBoard> make(const BoardSpec& spec) const;
+
+public:
+    explicit BoardPool(unsigned threads = 1);
+    ~BoardPool();
+
+    BoardPool(const BoardPool&) = delete;
+    BoardPool& operator=(const BoardPool&) = delete;
+
+    // marks spec as used, so that boards for it get prepared.
+    void want(const BoardSpec& spec);
+    // the mines of a prepared board, mapped so that click is a valid first
+    // click, or nothing if none fits; the board is removed from the pool.
+    // Also marks spec as used.
+    std::optional<std::vector<int>> take(const BoardSpec& spec, int click);
+    std::size_t ready(const BoardSpec& spec) const;
+
+    // the pool LazyInitBoard takes its boards from.
+    static BoardPool& shared();
+};
+
+}
@@ -9,8 +9,6 @@ const wxColour BoardView::FLAGGED_COLOR{0xff, 0x45, 0x00};
 const wxColour BoardView::BACKGROUND_COLOR{0xd3, 0xd3, 0xd3};
 const wxColour BoardView::HIGHLIGHT_COLOR{0xad, 0xd8, 0xe6};
 const wxColour BoardView::LINE_COLOR{0xf0, 0xf8, 0xff};
-//const QColor BoardView::ASSUMED_OPENED_COLOR { 0xa4, 0xd6, 0xa4 };
-const wxColour BoardView::ASSUMED_FLAGGED_COLOR{0xbf, 0xb2, 0x5f};
 
 BoardView::BoardView(wxWindow *parent,
                      wxWindowID id)
@@ -81,7 +79,7 @@ void BoardView::onPaint(wxPaintEvent &ev)
             auto drawNumber = false;
             auto flagged = false;
 
-            auto &cell = (*board)[cellIndex];
+            const auto cell = (*board)[cellIndex];
             switch (cell.state())
             {
             case CellState::Closed:
@@ -110,30 +108,16 @@ void BoardView::onPaint(wxPaintEvent &ev)
             {
                 painter.SetBrush(wxColour(0xdb, 0x70, 0x93));
                 painter.SetPen(wxColour(0xdb, 0x70, 0x93));
-                if (cell.is_assumption())
+                int bombs = cell.neighbor_bombs();
+                if (bombs != 0)
                 {
-                    painter.DrawText("?", wxRealPoint{initX + (cellWidth / 3), initY});
-                }
-                else
-                {
-                    int bombs = cell.neighbor_bombs();
-                    if (bombs != 0)
-                    {
-                        painter.DrawText(std::to_string(bombs), wxRealPoint{initX + (cellWidth / 3), initY + (cellHeight / 2)});
-                    }
+                    painter.DrawText(std::to_string(bombs), wxRealPoint{initX + (cellWidth / 3), initY + (cellHeight / 2)});
                 }
             }
 
             if (flagged)
             {
-                if (cell.is_assumption())
-                {
-                    painter.SetBrush(ASSUMED_FLAGGED_COLOR);
-                }
-                else
-                {
-                    painter.SetBrush(FLAGGED_COLOR);
-                }
+                painter.SetBrush(FLAGGED_COLOR);
                 auto cellWidthM = cellWidth - margin;
                 auto cellHeightM = cellHeight - margin;
                 auto flagWidth = cellWidthM / 2.0;
@@ -201,7 +185,7 @@ void BoardView::onMove(wxMouseEvent &ev)
 
 void BoardView::onClick(wxMouseEvent &ev)
 {
-    if (!board)
+    if (!board || inputLocked_)
     {
         return;
     }
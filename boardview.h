@@ -26,6 +26,7 @@ namespace minesweeper
     {
         std::shared_ptr<Board> board;
         bool discloseBombs_ = false;
+        bool inputLocked_ = false;
         std::optional<int> highlightedCell;
         std::unique_ptr<WinLoseAction> finalAction;
 
@@ -34,9 +35,7 @@ namespace minesweeper
 
         static const wxColour CLOSED_COLOR;
         static const wxColour OPENED_COLOR;
-        //static const QColor ASSUMED_OPENED_COLOR;
         static const wxColour FLAGGED_COLOR;
-        static const wxColour ASSUMED_FLAGGED_COLOR;
         static const wxColour BACKGROUND_COLOR;
         static const wxColour HIGHLIGHT_COLOR;
         static const wxColour LINE_COLOR;
@@ -70,6 +69,9 @@ namespace minesweeper
         }
         const bool &discloseBombs() const { return discloseBombs_; }
 
+        // clicks are ignored while locked, e.g. while a solver plays the board.
+        void setInputLocked(bool yes) { inputLocked_ = yes; }
+
         void setBoard(BoardReplaceEvent &ev);
 
         void forceRedraw(wxCommandEvent &ev)
@@ -0,0 +1,71 @@
+#include "componentcache.h"
+
+using namespace minesweeper;
+
+std::size_t ComponentCache::cost(const Item& item)
+{
+    // the key is stored twice, once in the list and once in the index.
+    auto bytes = 2 * item.first.size() + item.second.count.size() * sizeof(double) + 64;
+    for (const auto& row : item.second.cell_count) {
+        bytes += row.size() * sizeof(double);
+    }
+    return bytes;
+}
+
+ComponentCache& ComponentCache::shared()
+{
+    static ComponentCache cache;
+    return cache;
+}
+
+bool ComponentCache::find(const std::string& key, Entry& entry)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = index_.find(key);
+    if (found == index_.end()) {
+        misses_++;
+        return false;
+    }
+    items_.splice(items_.begin(), items_, found->second);
+    entry = found->second->second;
+    hits_++;
+    return true;
+}
+
+void ComponentCache::insert(std::string key, Entry entry)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index_.count(key) > 0) {
+        // another thread got there first.
+        return;
+    }
+    items_.emplace_front(std::move(key), std::move(entry));
+    bytes_ += cost(items_.front());
+    index_.emplace(items_.front().first, items_.begin());
+
+    while (bytes_ > capacity_bytes_ && items_.size() > 1) {
+        bytes_ -= cost(items_.back());
+        index_.erase(items_.back().first);
+        items_.pop_back();
+    }
+}
+
+void ComponentCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    items_.clear();
+    bytes_ = 0;
+}
+
+std::size_t ComponentCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+}
+
+std::size_t ComponentCache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
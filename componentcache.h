@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace minesweeper {
+
+// Enumeration results of frontier components, shared across solver calls.
+// The key is a canonical encoding of the component's constraints: each
+// number's remaining mine count and which of the component's cells (in the
+// enumerator's own order) it covers. It says nothing about where the
+// component sits on the board, so the same local situation is found again
+// after translation, on another board or in another generation attempt.
+// Keys are compared in full, so a hit is never a collision.
+// Least recently used entries are evicted once the size passes the byte budget.
+class ComponentCache {
+public:
+    struct Entry {
+        // valid configurations by mine count; all zero is a contradiction.
+        std::vector<double> count;
+        // [mine count][cell]: configurations in which the cell is a mine.
+        std::vector<std::vector<double>> cell_count;
+    };
+
+private:
+    using Item = std::pair<std::string, Entry>;
+
+    std::size_t capacity_bytes_;
+    std::size_t bytes_ = 0;
+    // most recently used first.
+    std::list<Item> items_;
+    std::unordered_map<std::string, std::list<Item>::iterator> index_;
+    mutable std::mutex mutex_;
+    std::atomic<long long> hits_ { 0 };
+    std::atomic<long long> misses_ { 0 };
+
+    static std::size_t cost(const Item& item);
+
+public:
+    explicit ComponentCache(std::size_t capacity_bytes = 32 << 20)
+        : capacity_bytes_(capacity_bytes)
+    {
+    }
+
+    ComponentCache(const ComponentCache&) = delete;
+    ComponentCache& operator=(const ComponentCache&) = delete;
+
+    // copies the entry for key into entry, if there is one.
+    bool find(const std::string& key, Entry& entry);
+    void insert(std::string key, Entry entry);
+    void clear();
+
+    std::size_t size() const;
+    std::size_t bytes() const;
+    long long hits() const { return hits_; }
+    long long misses() const { return misses_; }
+
+    // the cache FrontierEnumerator uses by default.
+    static ComponentCache& shared();
+};
+
+}
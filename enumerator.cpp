@@ -0,0 +1,418 @@
+#include "enumerator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+
+using namespace minesweeper;
+
+namespace {
+
+// smaller components are cheaper to search than to look up.
+constexpr std::size_t MIN_CACHED_CELLS = 8;
+
+// log(n!), tabulated per thread: std::lgamma writes the global signgam,
+// which races once boards are checked in parallel.
+double log_factorial(int n)
+{
+    thread_local std::vector<double> table { 0.0 };
+    while (static_cast<int>(table.size()) <= n) {
+        table.push_back(table.back() + std::log(static_cast<double>(table.size())));
+    }
+    return table[n];
+}
+
+double log_choose(int n, int k)
+{
+    if (k < 0 || k > n) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return log_factorial(n) - log_factorial(k) - log_factorial(n - k);
+}
+
+// a * b, rescaled so the largest entry is 1; only ratios matter below.
+std::vector<double> convolve(const std::vector<double>& a, const std::vector<double>& b)
+{
+    std::vector<double> result(a.size() + b.size() - 1, 0.0);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (a[i] == 0.0) {
+            continue;
+        }
+        for (std::size_t j = 0; j < b.size(); j++) {
+            result[i + j] += a[i] * b[j];
+        }
+    }
+    const auto largest = *std::max_element(result.begin(), result.end());
+    if (largest > 0.0) {
+        for (auto& value : result) {
+            value /= largest;
+        }
+    }
+    return result;
+}
+
+struct Component {
+    // board indices, in search order.
+    std::vector<int> cells;
+    // board indices of the revealed cells constraining them.
+    std::vector<int> constraints;
+    // number of valid configurations by mine count.
+    std::vector<double> count;
+    // [mine count][local cell]: configurations in which the cell is a mine.
+    std::vector<std::vector<double>> cell_count;
+    bool done = false;
+};
+
+// the component as ComponentCache sees it: per number, the mines still
+// missing, how many cells it covers and which ones, as 16-bit values.
+std::string component_key(const SolverState& state, const Component& component, const std::vector<int>& local)
+{
+    std::string key;
+    const auto put = [&key](int value) {
+        key.push_back(static_cast<char>(value & 0xff));
+        key.push_back(static_cast<char>((value >> 8) & 0xff));
+    };
+    for (auto index : component.constraints) {
+        put(state.number(index) - state.mines_around(index));
+        put(state.unknown_around(index));
+        for (auto next : state.board().neighbors(index)) {
+            if (state.is_unknown(next)) {
+                put(local[next]);
+            }
+        }
+    }
+    return key;
+}
+
+class Search {
+    Component& component;
+    std::vector<std::vector<int>> cell_constraints;
+    std::vector<int> need;
+    std::vector<int> mines;
+    std::vector<int> open;
+    std::vector<char> assignment;
+    long long& nodes;
+    long long max_nodes;
+    // bounds on the mines in this component, from the global count.
+    int min_mines = 0;
+    int max_mines = std::numeric_limits<int>::max();
+
+    bool go(int depth, int k)
+    {
+        if (++nodes > max_nodes) {
+            return false;
+        }
+        const int n = static_cast<int>(component.cells.size());
+        if (k > max_mines || k + (n - depth) < min_mines) {
+            return true;
+        }
+        if (depth == n) {
+            component.count[k] += 1.0;
+            for (int i = 0; i < n; i++) {
+                if (assignment[i]) {
+                    component.cell_count[k][i] += 1.0;
+                }
+            }
+            return true;
+        }
+
+        for (int value = 0; value <= 1; value++) {
+            bool ok = true;
+            for (auto c : cell_constraints[depth]) {
+                open[c]--;
+                mines[c] += value;
+                if (mines[c] > need[c] || mines[c] + open[c] < need[c]) {
+                    ok = false;
+                }
+            }
+            assignment[depth] = static_cast<char>(value);
+            const bool finished = !ok || go(depth + 1, k + value);
+            for (auto c : cell_constraints[depth]) {
+                open[c]++;
+                mines[c] -= value;
+            }
+            if (!finished) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    Search(const SolverState& state, Component& component, const std::vector<int>& local, long long& nodes, long long max_nodes)
+        : component(component)
+        , cell_constraints(component.cells.size())
+        , need(component.constraints.size())
+        , mines(component.constraints.size(), 0)
+        , open(component.constraints.size(), 0)
+        , assignment(component.cells.size(), 0)
+        , nodes(nodes)
+        , max_nodes(max_nodes)
+    {
+        const auto& board = state.board();
+        for (std::size_t c = 0; c < component.constraints.size(); c++) {
+            const auto index = component.constraints[c];
+            need[c] = state.number(index) - state.mines_around(index);
+            for (auto next : board.neighbors(index)) {
+                if (state.is_unknown(next)) {
+                    cell_constraints[local[next]].push_back(static_cast<int>(c));
+                    open[c]++;
+                }
+            }
+        }
+    }
+
+    // configurations outside [min_mines, max_mines] are not counted.
+    void limit_mines(int low, int high)
+    {
+        min_mines = low;
+        max_mines = high;
+    }
+
+    bool run()
+    {
+        const auto n = component.cells.size();
+        component.count.assign(n + 1, 0.0);
+        component.cell_count.assign(n + 1, std::vector<double>(n, 0.0));
+        return go(0, 0);
+    }
+};
+
+}
+
+EnumerationResult FrontierEnumerator::run(const SolverState& state) const
+{
+    EnumerationResult result;
+    const auto& board = state.board();
+    const auto total = state.total_cells();
+
+    // group the unknown frontier cells; two cells belong together when some
+    // number sees both. Cells are numbered in breadth-first order so the
+    // search closes constraints early.
+    std::vector<int> local(total, -1);
+    std::vector<int> owner(total, -1);
+    std::vector<Component> components;
+    state.frontier().for_each([&](int start) {
+        if (owner[start] >= 0) {
+            return;
+        }
+        const auto id = static_cast<int>(components.size());
+        components.emplace_back();
+        auto& component = components.back();
+        owner[start] = id;
+        component.constraints.push_back(start);
+        for (std::size_t head = 0; head < component.constraints.size(); head++) {
+            for (auto cell : board.neighbors(component.constraints[head])) {
+                if (!state.is_unknown(cell) || local[cell] >= 0) {
+                    continue;
+                }
+                local[cell] = static_cast<int>(component.cells.size());
+                component.cells.push_back(cell);
+                for (auto next : board.neighbors(cell)) {
+                    if (state.frontier().test(next) && owner[next] < 0) {
+                        owner[next] = id;
+                        component.constraints.push_back(next);
+                    }
+                }
+            }
+        }
+    });
+    result.components = static_cast<int>(components.size());
+
+    int frontier_cells = 0;
+    for (const auto& component : components) {
+        frontier_cells += static_cast<int>(component.cells.size());
+    }
+    const auto remaining_mines = state.total_mines() - state.mine_count();
+    const auto rest_cells = total - state.safe_count() - state.mine_count() - frontier_cells;
+
+    // near the end the global count bounds every component, which keeps
+    // even large ones small enough to search in full.
+    result.endgame = total - state.safe_count() - state.mine_count() <= endgame_cells_;
+
+    for (auto& component : components) {
+        const auto size = static_cast<int>(component.cells.size());
+        if (size > max_component_cells_ && !result.endgame) {
+            result.complete = false;
+            continue;
+        }
+
+        // bounded counts depend on more than the component, so they are not shared.
+        const auto cacheable = cache_ != nullptr && !result.endgame && component.cells.size() >= MIN_CACHED_CELLS;
+        std::string key;
+        if (cacheable) {
+            key = component_key(state, component, local);
+            ComponentCache::Entry entry;
+            if (cache_->find(key, entry)) {
+                component.count = std::move(entry.count);
+                component.cell_count = std::move(entry.cell_count);
+                result.cached++;
+            }
+        }
+        if (component.count.empty()) {
+            Search search(state, component, local, result.nodes, max_nodes_);
+            if (result.endgame) {
+                // whatever this component leaves must fit on the other unknown cells.
+                search.limit_mines(remaining_mines - rest_cells - (frontier_cells - size), remaining_mines);
+            }
+            if (!search.run()) {
+                result.complete = false;
+                continue;
+            }
+            if (cacheable) {
+                cache_->insert(std::move(key), { component.count, component.cell_count });
+            }
+        }
+        component.done = true;
+        if (std::all_of(component.count.begin(), component.count.end(), [](double c) { return c == 0.0; })) {
+            result.contradiction = true;
+            return result;
+        }
+    }
+
+    if (!result.complete) {
+        // without every component the global count cannot be used; a cell is
+        // still certain if it agrees across all configurations of its own component.
+        for (const auto& component : components) {
+            if (!component.done) {
+                continue;
+            }
+            for (std::size_t i = 0; i < component.cells.size(); i++) {
+                bool always_safe = true;
+                bool always_mine = true;
+                for (std::size_t k = 0; k < component.count.size(); k++) {
+                    if (component.count[k] == 0.0) {
+                        continue;
+                    }
+                    always_safe = always_safe && component.cell_count[k][i] == 0.0;
+                    always_mine = always_mine && component.cell_count[k][i] == component.count[k];
+                }
+                if (always_safe) {
+                    result.safe.push_back(component.cells[i]);
+                } else if (always_mine) {
+                    result.mines.push_back(component.cells[i]);
+                }
+            }
+        }
+        return result;
+    }
+
+    // weight of putting m mines on the frontier: ways to place the rest elsewhere.
+    std::vector<double> log_weight(frontier_cells + 1);
+    double largest = -std::numeric_limits<double>::infinity();
+    for (int m = 0; m <= frontier_cells; m++) {
+        log_weight[m] = log_choose(rest_cells, remaining_mines - m);
+        largest = std::max(largest, log_weight[m]);
+    }
+    if (largest == -std::numeric_limits<double>::infinity()) {
+        result.contradiction = true;
+        return result;
+    }
+    std::vector<double> weight(frontier_cells + 1);
+    for (int m = 0; m <= frontier_cells; m++) {
+        weight[m] = std::exp(log_weight[m] - largest);
+    }
+    const auto feasible = [&](int m) {
+        return remaining_mines - m >= 0 && remaining_mines - m <= rest_cells;
+    };
+
+    result.probability.assign(total, 0.0);
+    state.mine().for_each([&](int index) {
+        result.probability[index] = 1.0;
+    });
+
+    std::vector<double> all { 1.0 };
+    for (const auto& component : components) {
+        all = convolve(all, component.count);
+    }
+    double z = 0.0;
+    for (std::size_t m = 0; m < all.size(); m++) {
+        z += all[m] * weight[m];
+    }
+    if (z == 0.0) {
+        result.contradiction = true;
+        return result;
+    }
+
+    for (std::size_t c = 0; c < components.size(); c++) {
+        const auto& component = components[c];
+        std::vector<double> others { 1.0 };
+        for (std::size_t o = 0; o < components.size(); o++) {
+            if (o != c) {
+                others = convolve(others, components[o].count);
+            }
+        }
+
+        // weight of each mine count of this component, given the others.
+        std::vector<double> support(component.count.size(), 0.0);
+        std::vector<bool> possible(component.count.size(), false);
+        double component_z = 0.0;
+        for (std::size_t k = 0; k < component.count.size(); k++) {
+            if (component.count[k] == 0.0) {
+                continue;
+            }
+            for (std::size_t j = 0; j < others.size(); j++) {
+                if (others[j] > 0.0 && feasible(static_cast<int>(k + j))) {
+                    support[k] += others[j] * weight[k + j];
+                    possible[k] = true;
+                }
+            }
+            component_z += component.count[k] * support[k];
+        }
+
+        for (std::size_t i = 0; i < component.cells.size(); i++) {
+            bool always_safe = true;
+            bool always_mine = true;
+            double p = 0.0;
+            for (std::size_t k = 0; k < component.count.size(); k++) {
+                if (!possible[k]) {
+                    continue;
+                }
+                p += component.cell_count[k][i] * support[k];
+                always_safe = always_safe && component.cell_count[k][i] == 0.0;
+                always_mine = always_mine && component.cell_count[k][i] == component.count[k];
+            }
+            result.probability[component.cells[i]] = component_z > 0.0 ? p / component_z : 0.0;
+            if (always_safe) {
+                result.safe.push_back(component.cells[i]);
+            } else if (always_mine) {
+                result.mines.push_back(component.cells[i]);
+            }
+        }
+    }
+
+    if (rest_cells > 0) {
+        bool always_safe = true;
+        bool always_mine = true;
+        double p = 0.0;
+        for (std::size_t m = 0; m < all.size(); m++) {
+            if (all[m] == 0.0 || !feasible(static_cast<int>(m))) {
+                continue;
+            }
+            const auto rest = remaining_mines - static_cast<int>(m);
+            p += all[m] * weight[m] * rest / rest_cells;
+            always_safe = always_safe && rest == 0;
+            always_mine = always_mine && rest == rest_cells;
+        }
+        std::vector<char> in_frontier(total, 0);
+        for (const auto& component : components) {
+            for (auto cell : component.cells) {
+                in_frontier[cell] = 1;
+            }
+        }
+        for (int i = 0; i < total; i++) {
+            if (!state.is_unknown(i) || in_frontier[i]) {
+                continue;
+            }
+            result.probability[i] = p / z;
+            if (always_safe) {
+                result.safe.push_back(i);
+            } else if (always_mine) {
+                result.mines.push_back(i);
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "componentcache.h"
+#include "solverstate.h"
+#include <vector>
+
+namespace minesweeper {
+
+struct EnumerationResult {
+    // some component has no valid mine configuration.
+    bool contradiction = false;
+    // every component was enumerated; otherwise only the finished ones
+    // contributed deductions and probabilities are not filled in.
+    bool complete = true;
+    int components = 0;
+    // the endgame rules applied, see FrontierEnumerator.
+    bool endgame = false;
+    // components answered by the cache instead of a search.
+    int cached = 0;
+    long long nodes = 0;
+
+    std::vector<int> safe;
+    std::vector<int> mines;
+    // mine probability per cell: 0 or 1 for known cells.
+    std::vector<double> probability;
+};
+
+// Exact reasoning over the unknown frontier.
+// The unknown cells next to a revealed number are split into components
+// that share no constraint, and the mine configurations of each component
+// are enumerated by backtracking. Combined with the number of mines left
+// for the cells no number touches, this gives exact mine probabilities and
+// every cell that is certain.
+// Component results are looked up in cache first, if one is given.
+// Once at most endgame_cells cells are unknown, components of any size are
+// searched, and each search skips configurations the remaining mine count
+// rules out: too many mines, or too few to leave room on the other cells.
+class FrontierEnumerator {
+    int max_component_cells_;
+    long long max_nodes_;
+    ComponentCache* cache_;
+    int endgame_cells_;
+
+public:
+    explicit FrontierEnumerator(int max_component_cells = 48, long long max_nodes = 1000000,
+        ComponentCache* cache = &ComponentCache::shared(), int endgame_cells = 128)
+        : max_component_cells_(max_component_cells)
+        , max_nodes_(max_nodes)
+        , cache_(cache)
+        , endgame_cells_(endgame_cells)
+    {
+    }
+
+    EnumerationResult run(const SolverState& state) const;
+};
+
+}
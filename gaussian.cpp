@@ -0,0 +1,190 @@
+#include "gaussian.h"
+#include <utility>
+
+using namespace minesweeper;
+
+namespace {
+
+using Word = BitPlane::Word;
+
+// coefficients of one equation over the local variables, plus its right-hand side.
+struct Row {
+    std::vector<Word> plus;
+    std::vector<Word> minus;
+    int value = 0;
+
+    bool coefficient_plus(int v) const { return (plus[v / BitPlane::WORD_BITS] >> (v % BitPlane::WORD_BITS)) & 1; }
+    bool coefficient_minus(int v) const { return (minus[v / BitPlane::WORD_BITS] >> (v % BitPlane::WORD_BITS)) & 1; }
+
+    void negate()
+    {
+        std::swap(plus, minus);
+        value = -value;
+    }
+};
+
+// this -= pivot, unless some cell would end up with a coefficient of 2.
+bool subtract(Row& row, const Row& pivot)
+{
+    const auto words = row.plus.size();
+    for (std::size_t w = 0; w < words; w++) {
+        if ((row.plus[w] & pivot.minus[w]) | (row.minus[w] & pivot.plus[w])) {
+            return false;
+        }
+    }
+    for (std::size_t w = 0; w < words; w++) {
+        const auto plus = (row.plus[w] & ~pivot.plus[w]) | (pivot.minus[w] & ~row.minus[w]);
+        const auto minus = (row.minus[w] & ~pivot.minus[w]) | (pivot.plus[w] & ~row.plus[w]);
+        row.plus[w] = plus;
+        row.minus[w] = minus;
+    }
+    row.value -= pivot.value;
+    return true;
+}
+
+// this += pivot, with the same restriction.
+bool add(Row& row, const Row& pivot)
+{
+    row.negate();
+    const auto ok = subtract(row, pivot);
+    row.negate();
+    return ok;
+}
+
+int count(const std::vector<Word>& words)
+{
+    int n = 0;
+    for (auto w : words) {
+        n += popcount(w);
+    }
+    return n;
+}
+
+template <typename F>
+void for_each(const std::vector<Word>& words, F f)
+{
+    for (std::size_t w = 0; w < words.size(); w++) {
+        for (auto bits = words[w]; bits != 0; bits &= bits - 1) {
+            f(static_cast<int>(w) * BitPlane::WORD_BITS + lowest_bit(bits));
+        }
+    }
+}
+
+}
+
+LinearResult GaussianEliminator::run(const SolverState& state) const
+{
+    LinearResult result;
+    const auto& board = state.board();
+    const auto total = state.total_cells();
+
+    // variables: unknown cells, the ones next to a number first.
+    std::vector<int> local(total, -1);
+    std::vector<int> cells;
+    state.frontier().for_each([&](int index) {
+        for (auto next : board.neighbors(index)) {
+            if (state.is_unknown(next) && local[next] < 0) {
+                local[next] = static_cast<int>(cells.size());
+                cells.push_back(next);
+            }
+        }
+    });
+    for (int i = 0; i < total; i++) {
+        if (state.is_unknown(i) && local[i] < 0) {
+            local[i] = static_cast<int>(cells.size());
+            cells.push_back(i);
+        }
+    }
+    const auto variables = static_cast<int>(cells.size());
+    result.variables = variables;
+    if (variables == 0) {
+        return result;
+    }
+    const auto words = static_cast<std::size_t>((variables + BitPlane::WORD_BITS - 1) / BitPlane::WORD_BITS);
+
+    std::vector<Row> rows;
+    const auto new_row = [&](int value) -> Row& {
+        rows.push_back({ std::vector<Word>(words, 0), std::vector<Word>(words, 0), value });
+        return rows.back();
+    };
+    state.frontier().for_each([&](int index) {
+        auto& row = new_row(state.number(index) - state.mines_around(index));
+        for (auto next : board.neighbors(index)) {
+            if (state.is_unknown(next)) {
+                const auto v = local[next];
+                row.plus[v / BitPlane::WORD_BITS] |= Word(1) << (v % BitPlane::WORD_BITS);
+            }
+        }
+    });
+    {
+        auto& row = new_row(state.total_mines() - state.mine_count());
+        for (int v = 0; v < variables; v++) {
+            row.plus[v / BitPlane::WORD_BITS] |= Word(1) << (v % BitPlane::WORD_BITS);
+        }
+    }
+    result.equations = static_cast<int>(rows.size());
+
+    // row-reduce, one pivot per column.
+    std::size_t next_pivot = 0;
+    for (int v = 0; v < variables && next_pivot < rows.size(); v++) {
+        std::size_t found = rows.size();
+        for (auto r = next_pivot; r < rows.size(); r++) {
+            if (rows[r].coefficient_plus(v) || rows[r].coefficient_minus(v)) {
+                found = r;
+                break;
+            }
+        }
+        if (found == rows.size()) {
+            continue;
+        }
+        std::swap(rows[next_pivot], rows[found]);
+        auto& pivot = rows[next_pivot];
+        if (pivot.coefficient_minus(v)) {
+            pivot.negate();
+        }
+        for (std::size_t r = 0; r < rows.size(); r++) {
+            if (r == next_pivot) {
+                continue;
+            }
+            if (rows[r].coefficient_plus(v)) {
+                subtract(rows[r], pivot);
+            } else if (rows[r].coefficient_minus(v)) {
+                add(rows[r], pivot);
+            }
+        }
+        next_pivot++;
+    }
+
+    std::vector<char> decided(variables, 0);
+    for (const auto& row : rows) {
+        const auto plus = count(row.plus);
+        const auto minus = count(row.minus);
+        if (row.value > plus || row.value < -minus) {
+            result.contradiction = true;
+            return result;
+        }
+        if (plus + minus == 0) {
+            continue;
+        }
+        // at the upper end every plus cell is a mine and every minus cell is
+        // safe; at the lower end it is the other way round.
+        const auto upper = row.value == plus;
+        const auto lower = row.value == -minus;
+        if (!upper && !lower) {
+            continue;
+        }
+        for_each(row.plus, [&](int v) {
+            if (!decided[v]) {
+                decided[v] = 1;
+                (upper ? result.mines : result.safe).push_back(cells[v]);
+            }
+        });
+        for_each(row.minus, [&](int v) {
+            if (!decided[v]) {
+                decided[v] = 1;
+                (upper ? result.safe : result.mines).push_back(cells[v]);
+            }
+        });
+    }
+    return result;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "solverstate.h"
+#include <vector>
+
+namespace minesweeper {
+
+struct LinearResult {
+    // some equation has no 0/1 solution.
+    bool contradiction = false;
+    int equations = 0;
+    int variables = 0;
+
+    std::vector<int> safe;
+    std::vector<int> mines;
+};
+
+// Deduction by row-reducing the frontier as a linear system.
+// Every revealed number gives "sum of its unknown neighbors = number - known
+// mines", and the global mine count gives one more equation over all unknown
+// cells. Coefficients stay in {-1, 0, 1}, so a row is a pair of bit rows
+// (plus and minus) and elimination is a handful of word-wide and/andnot/or.
+// An elimination that would produce a coefficient of 2 is skipped, so every
+// row is still a valid equation, just not fully reduced.
+// A row is then decided by its bounds: with P plus and N minus cells the sum
+// lies in [-|N|, |P|], and when the right-hand side sits on either end every
+// cell of the row is forced.
+class GaussianEliminator {
+public:
+    LinearResult run(const SolverState& state) const;
+};
+
+}
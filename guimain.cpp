@@ -3,6 +3,7 @@
 #include "board.h"
 #include "boardconfigview.h"
 #include "boardview.h"
+#include "strategy.h"
 #include <thread>
 
 namespace minesweeper
@@ -10,43 +11,51 @@ namespace minesweeper
 
     wxDEFINE_EVENT(MAIN_REDRAW_ALL, wxCommandEvent);
     wxDEFINE_EVENT(MAIN_REPLACE_BOARD, BoardReplaceEvent);
+    wxDEFINE_EVENT(MAIN_SOLVER_MOVES, SolverMovesEvent);
+    wxDEFINE_EVENT(MAIN_SOLVE_FINISHED, wxCommandEvent);
 
     struct RedrawCallback : public AICallback
     {
     private:
         GuiMain *gm;
+        std::shared_ptr<Board> target;
         double intervalSeconds;
-        int lastNestLevel = 0;
 
     public:
-        RedrawCallback(GuiMain *gm, double intervalSeconds)
-            : gm(gm), intervalSeconds(intervalSeconds)
+        RedrawCallback(GuiMain *gm, std::shared_ptr<Board> target, double intervalSeconds)
+            : gm(gm), target(std::move(target)), intervalSeconds(intervalSeconds)
         {
         }
         ~RedrawCallback() {}
 
         // AICallback interface
     public:
-        void before_start(const std::shared_ptr<Board> &) override
+        void before_start(const SolverState &) override
         {
         }
 
-        bool on_step(const std::shared_ptr<Board> &board, int /*current_step*/, int nest_level) override
+        bool on_step(const SolverState &state, int /*current_step*/, int /*nest_level*/) override
         {
-            if (board->failed() || board->cleared())
+            // speculation does not touch the board, so only real moves are worth showing.
+            if (state.speculating())
+                return true;
+            if (gm->autoSolveCancelled())
+                return false;
+            // called from the solving thread, so the moves are queued for the GUI thread.
+            const auto &played = state.board();
+            SolverMovesEvent moves(MAIN_SOLVER_MOVES, gm->GetId(), target, played.opened(), played.flagged());
+            moves.SetEventObject(gm);
+            wxQueueEvent(gm, moves.Clone());
+            if (played.failed() || played.cleared())
                 return false;
-            if (lastNestLevel != nest_level)
-            {
-                BoardReplaceEvent event(MAIN_REPLACE_BOARD, gm->GetId(), board);
-                event.SetEventObject(gm);
-                gm->ProcessWindowEvent(event);
-            }
-            wxCommandEvent redr(MAIN_REDRAW_ALL, gm->GetId());
-            redr.SetEventObject(gm);
-            gm->ProcessWindowEvent(redr);
             std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<long>(intervalSeconds * 1000)));
             return true;
         }
+
+        bool cancelled() const override
+        {
+            return gm->autoSolveCancelled();
+        }
     };
 
     GuiMain::GuiMain()
@@ -60,12 +69,23 @@ namespace minesweeper
         auto *game = new wxMenu;
         auto *newGame = game->Append(wxID_ANY, "New game");
         auto *showAnswer = game->Append(wxID_ANY, "Show answer");
+        auto *solver = new wxMenu;
+        for (const auto &name : StrategyRegistry::names())
+        {
+            auto *item = solver->AppendRadioItem(wxID_ANY, name);
+            item->Check(name == StrategyRegistry::default_name());
+            Bind(wxEVT_MENU, [this, name](wxCommandEvent &) { selectSolver(name); }, item->GetId());
+        }
         auto *menubar = new wxMenuBar;
         menubar->Append(game, "&Game");
+        menubar->Append(solver, "&Solver");
         SetMenuBar(menubar);
+        solverName = StrategyRegistry::default_name();
 
         Bind(MAIN_REDRAW_ALL, &BoardView::forceRedraw, central);
         Bind(MAIN_REPLACE_BOARD, &BoardView::setBoard, central);
+        Bind(MAIN_SOLVER_MOVES, &GuiMain::applySolverMoves, this);
+        Bind(MAIN_SOLVE_FINISHED, &GuiMain::finishAutoSolve, this);
 
         Bind(wxEVT_MENU, &GuiMain::showNewGameWindow, this, newGame->GetId());
         Bind(wxEVT_MENU, &GuiMain::startAutoSolve, this, showAnswer->GetId());
@@ -78,24 +98,95 @@ namespace minesweeper
 
     void GuiMain::autoSolve(double intervalSeconds)
     {
-        // QThread *thread = QThread::create([board = this->board, this, intervalSeconds]() {
-        //     RedrawCallback rc(this, intervalSeconds);
-        //     try
-        //     {
-        //         MineAI::solve_all(board, true, rc);
-        //     }
-        //     catch (const AIReasoningError &e)
-        //     {
-        //         qDebug("WARNING: this is unsolvable!");
-        //     }
-        // });
-        // thread->start();
-        std::cerr << "This feature is disabled now." << std::endl;
+        if (solving)
+        {
+            return;
+        }
+        if (solveThread.joinable())
+        {
+            solveThread.join();
+        }
+        solving = true;
+        central->setInputLocked(true);
+        // the GUI keeps reading and changing the board, so the solver plays
+        // a copy of it and only the GUI thread touches the board itself.
+        auto played = std::make_shared<Board>(*board);
+        solveThread = std::thread([target = this->board, played, this, intervalSeconds, name = solverName]() {
+            RedrawCallback rc(this, target, intervalSeconds);
+            const auto solver = StrategyRegistry::create(name);
+            if (solver->play(*played, rc).result == SolveResult::Stuck)
+            {
+                std::cerr << "WARNING: " << name << " is stuck on this board" << std::endl;
+            }
+            solving = false;
+            wxCommandEvent finished(MAIN_SOLVE_FINISHED, GetId());
+            finished.SetEventObject(this);
+            wxQueueEvent(this, finished.Clone());
+        });
+    }
+
+    void GuiMain::stopAutoSolve()
+    {
+        cancelSolving = true;
+        if (solveThread.joinable())
+        {
+            solveThread.join();
+        }
+        cancelSolving = false;
+        central->setInputLocked(false);
+    }
+
+    void GuiMain::applySolverMoves(SolverMovesEvent &ev)
+    {
+        // moves queued before a new game was started.
+        if (ev.target != board)
+        {
+            return;
+        }
+        ev.opened.for_each([this](int index) {
+            if (board->state(index) == CellState::Flagged)
+            {
+                board->toggle_flag(index);
+            }
+            if (board->state(index) != CellState::Opened)
+            {
+                board->open_cell(index);
+            }
+        });
+        ev.flagged.for_each([this](int index) {
+            if (board->state(index) == CellState::Closed)
+            {
+                board->toggle_flag(index);
+            }
+        });
+        central->Refresh();
+    }
+
+    void GuiMain::finishAutoSolve(wxCommandEvent &)
+    {
+        // a newer solve may have started since this one was queued.
+        if (!solving)
+        {
+            central->setInputLocked(false);
+        }
+    }
+
+    GuiMain::~GuiMain()
+    {
+        cancelSolving = true;
+        if (solveThread.joinable())
+        {
+            solveThread.join();
+        }
     }
 
     void GuiMain::newGame(int width, int height, int n_bombs)
     {
-        board = std::shared_ptr<Board>(new LazyInitBoard(width, height, n_bombs, true));
+        stopAutoSolve();
+        // a first click that always opens a region, as players expect.
+        auto *lazy = new LazyInitBoard(width, height, n_bombs, true, std::nullopt, Generation::Rejection, 1);
+        lazy->warm_up();
+        board = std::shared_ptr<Board>(lazy);
         BoardReplaceEvent event(MAIN_REPLACE_BOARD, GetId(), board);
         event.SetEventObject(this);
         ProcessWindowEvent(event);
@@ -122,6 +213,16 @@ namespace minesweeper
         autoSolve(0.2);
     }
 
+    void GuiMain::selectSolver(const std::string &name)
+    {
+        // only auto-solve uses it; the boards themselves are still checked
+        // with BoardBuilder's strategy.
+        if (StrategyRegistry::create(name))
+        {
+            solverName = name;
+        }
+    }
+
     void MainCallback::onWin(minesweeper::BoardView &bv)
     {
         bv.setDiscloseBombs(true);
@@ -1,9 +1,13 @@
 #ifndef MINESWEEPER_GUIMAIN_H
 #define MINESWEEPER_GUIMAIN_H
 
+#include "bitplane.h"
 #include "boardview.h"
 #include <wx/wx.h>
+#include <atomic>
 #include <memory>
+#include <string>
+#include <thread>
 
 namespace minesweeper
 {
@@ -19,6 +23,20 @@ namespace minesweeper
         std::shared_ptr<Board> newBoard;
     };
 
+    // the cells the auto-solver has opened and flagged on its copy of target
+    // so far, to be played on target itself.
+    struct SolverMovesEvent : wxEvent
+    {
+        SolverMovesEvent(wxEventType eventType, int winid, std::shared_ptr<Board> target, BitPlane opened, BitPlane flagged)
+            : wxEvent(winid, eventType), target(std::move(target)), opened(std::move(opened)), flagged(std::move(flagged)) {}
+
+        virtual wxEvent *Clone() const { return new SolverMovesEvent(*this); }
+
+        std::shared_ptr<Board> target;
+        BitPlane opened;
+        BitPlane flagged;
+    };
+
     struct MainCallback : public WinLoseAction
     {
         // WinLoseAction interface
@@ -31,15 +49,32 @@ namespace minesweeper
     class GuiMain : public wxFrame
     {
         std::shared_ptr<Board> board;
+        // strategy used by autoSolve; new boards are checked with the registry default.
+        std::string solverName;
+        std::thread solveThread;
+        std::atomic<bool> solving{false};
+        std::atomic<bool> cancelSolving{false};
+
+        // cancels a running autoSolve and waits for it to finish.
+        void stopAutoSolve();
+        void applySolverMoves(SolverMovesEvent &ev);
+        void finishAutoSolve(wxCommandEvent &ev);
 
     public:
         GuiMain();
+        ~GuiMain();
 
+        // plays a copy of the board with solverName on a background thread
+        // and repeats its moves on the board after every step, on the GUI
+        // thread. Clicks are ignored until it is done. Does nothing while a
+        // solve is still running.
         void autoSolve(double intervalSeconds);
 
         void newGame(int width, int height, int n_bombs);
         void showNewGameWindow(wxCommandEvent &ev);
         void startAutoSolve(wxCommandEvent &ev);
+        void selectSolver(const std::string &name);
+        bool autoSolveCancelled() const { return cancelSolving; }
     
     private:
         BoardView *central;
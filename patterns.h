@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace minesweeper {
+namespace patterns {
+
+// Compile-time tables for the two-number patterns (1-1, 1-2, 1-2-1, ...).
+// A revealed cell a is described by the 3x3 window around it: one bit per
+// neighbor, set when the neighbor is unknown. For every partner b within
+// the 5x5 window, the neighbors of a that b also sees form a constant mask,
+// so the unknown cells split into "only a", "shared" and "only b" with one
+// and and popcount. The outcome for those sizes and the mines still
+// missing around a and b is then a single lookup in RULES.
+
+struct Offset {
+    int dx;
+    int dy;
+};
+
+// bit k of a window is the neighbor at NEIGHBORS[k].
+constexpr std::array<Offset, 8> NEIGHBORS = { {
+    { -1, -1 }, { 0, -1 }, { 1, -1 },
+    { -1, 0 }, { 1, 0 },
+    { -1, 1 }, { 0, 1 }, { 1, 1 },
+} };
+
+constexpr int abs_of(int value) { return value < 0 ? -value : value; }
+
+constexpr int bit_count(std::uint32_t mask)
+{
+    int n = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        n++;
+    }
+    return n;
+}
+
+struct Partner {
+    int dx;
+    int dy;
+    // neighbors of a that are also neighbors of the partner.
+    std::uint8_t shared;
+};
+
+template <int Dx, int Dy>
+constexpr Partner partner()
+{
+    static_assert((Dx != 0 || Dy != 0) && abs_of(Dx) <= 2 && abs_of(Dy) <= 2, "partner must be within the 5x5 window");
+    Partner result { Dx, Dy, 0 };
+    for (int k = 0; k < 8; k++) {
+        const auto dx = NEIGHBORS[k].dx - Dx;
+        const auto dy = NEIGHBORS[k].dy - Dy;
+        if (abs_of(dx) <= 1 && abs_of(dy) <= 1 && (dx != 0 || dy != 0)) {
+            result.shared = static_cast<std::uint8_t>(result.shared | (1u << k));
+        }
+    }
+    return result;
+}
+
+// partners after a in row-major order, so that each pair is looked at once.
+constexpr std::array<Partner, 12> PARTNERS = {
+    partner<1, 0>(), partner<2, 0>(),
+    partner<-2, 1>(), partner<-1, 1>(), partner<0, 1>(), partner<1, 1>(), partner<2, 1>(),
+    partner<-2, 2>(), partner<-1, 2>(), partner<0, 2>(), partner<1, 2>(), partner<2, 2>()
+};
+
+static_assert(bit_count(PARTNERS[0].shared) == 4, "side by side numbers share 4 cells");
+static_assert(bit_count(PARTNERS[1].shared) == 3, "numbers one apart share 3 cells");
+static_assert(bit_count(PARTNERS[11].shared) == 1, "diagonal numbers two apart share 1 cell");
+
+enum : std::uint8_t {
+    A_MINE = 1 << 0,
+    A_SAFE = 1 << 1,
+    SHARED_MINE = 1 << 2,
+    SHARED_SAFE = 1 << 3,
+    B_MINE = 1 << 4,
+    B_SAFE = 1 << 5,
+    CONTRADICTION = 1 << 6,
+};
+
+constexpr int RULE_DIM = 9;
+constexpr int RULE_SIZE = RULE_DIM * RULE_DIM * RULE_DIM * RULE_DIM * RULE_DIM;
+
+// a, shared, b: unknown cells only a sees, both see, only b sees.
+// need_a, need_b: mines still missing around a and b.
+constexpr int rule_index(int a, int shared, int b, int need_a, int need_b)
+{
+    return (((a * RULE_DIM + shared) * RULE_DIM + b) * RULE_DIM + need_a) * RULE_DIM + need_b;
+}
+
+constexpr std::array<std::uint8_t, RULE_SIZE> make_rules()
+{
+    std::array<std::uint8_t, RULE_SIZE> rules {};
+    for (int a = 0; a < RULE_DIM; a++) {
+        for (int shared = 0; shared < RULE_DIM; shared++) {
+            for (int b = 0; b < RULE_DIM; b++) {
+                for (int need_a = 0; need_a < RULE_DIM; need_a++) {
+                    for (int need_b = 0; need_b < RULE_DIM; need_b++) {
+                        // mines in the shared cells: enough for both numbers,
+                        // but not more than either allows.
+                        const auto low = std::max({ 0, need_a - a, need_b - b });
+                        const auto high = std::min({ shared, need_a, need_b });
+                        std::uint8_t code = 0;
+                        if (low > high) {
+                            code = CONTRADICTION;
+                        } else {
+                            if (a > 0 && need_a - low == 0) {
+                                code |= A_SAFE;
+                            } else if (a > 0 && need_a - high == a) {
+                                code |= A_MINE;
+                            }
+                            if (shared > 0 && high == 0) {
+                                code |= SHARED_SAFE;
+                            } else if (shared > 0 && low == shared) {
+                                code |= SHARED_MINE;
+                            }
+                            if (b > 0 && need_b - low == 0) {
+                                code |= B_SAFE;
+                            } else if (b > 0 && need_b - high == b) {
+                                code |= B_MINE;
+                            }
+                        }
+                        rules[rule_index(a, shared, b, need_a, need_b)] = code;
+                    }
+                }
+            }
+        }
+    }
+    return rules;
+}
+
+constexpr std::array<std::uint8_t, RULE_SIZE> RULES = make_rules();
+
+// the 1-2 pattern: the 2's own cell is a mine and the 1's own cells are safe.
+static_assert(RULES[rule_index(2, 2, 1, 1, 2)] == (A_SAFE | B_MINE), "1-2 pattern");
+static_assert(RULES[rule_index(0, 2, 1, 3, 1)] == CONTRADICTION, "too few cells for a 3");
+
+}
+}
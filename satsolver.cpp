@@ -0,0 +1,401 @@
+#include "satsolver.h"
+#include <algorithm>
+#include <utility>
+
+using namespace minesweeper;
+
+namespace {
+
+constexpr double ACTIVITY_DECAY = 0.95;
+constexpr double ACTIVITY_LIMIT = 1e100;
+constexpr long long RESTART_BASE = 100;
+
+// 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+long long luby(long long x)
+{
+    long long size = 1;
+    int sequence = 0;
+    while (size < x + 1) {
+        sequence++;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != x) {
+        size = (size - 1) >> 1;
+        sequence--;
+        x = x % size;
+    }
+    return 1LL << sequence;
+}
+
+}
+
+int SatSolver::new_var()
+{
+    const auto var = vars();
+    assigns_.push_back(-1);
+    level_.push_back(0);
+    reason_.push_back(-1);
+    activity_.push_back(0.0);
+    // most cells are safe, so try false first.
+    polarity_.push_back(0);
+    seen_.push_back(0);
+    heap_position_.push_back(-1);
+    watches_.emplace_back();
+    watches_.emplace_back();
+    heap_insert(var);
+    return var;
+}
+
+bool SatSolver::add_clause(std::vector<Literal> literals)
+{
+    if (!ok_) {
+        return false;
+    }
+    // only ever called between solves, at the root.
+    std::sort(literals.begin(), literals.end());
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < literals.size(); i++) {
+        const auto literal = literals[i];
+        if (value(literal) == 1 || (i > 0 && literal == negate(literals[i - 1]))) {
+            // satisfied, or a tautology.
+            return true;
+        }
+        if (value(literal) == 0 || (kept > 0 && literals[kept - 1] == literal)) {
+            continue;
+        }
+        literals[kept++] = literal;
+    }
+    literals.resize(kept);
+
+    if (literals.empty()) {
+        ok_ = false;
+    } else if (literals.size() == 1) {
+        enqueue(literals[0], -1);
+        ok_ = propagate() < 0;
+    } else {
+        attach(std::move(literals), false);
+    }
+    return ok_;
+}
+
+int SatSolver::attach(std::vector<Literal> literals, bool learnt)
+{
+    const auto index = static_cast<int>(clauses_.size());
+    watches_[literals[0]].push_back(index);
+    watches_[literals[1]].push_back(index);
+    clauses_.push_back({ std::move(literals), learnt, false });
+    if (learnt) {
+        learnt_count_++;
+        stats_.learnt++;
+    }
+    return index;
+}
+
+void SatSolver::enqueue(Literal literal, int reason)
+{
+    const auto var = var_of(literal);
+    assigns_[var] = static_cast<std::int8_t>((literal & 1) ^ 1);
+    level_[var] = decision_level();
+    reason_[var] = reason;
+    trail_.push_back(literal);
+}
+
+// returns the conflicting clause, or -1.
+int SatSolver::propagate()
+{
+    while (queue_head_ < trail_.size()) {
+        const auto falsified = negate(trail_[queue_head_++]);
+        stats_.propagations++;
+        auto& watching = watches_[falsified];
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < watching.size(); i++) {
+            const auto index = watching[i];
+            auto& clause = clauses_[index];
+            if (clause.removed) {
+                continue;
+            }
+            auto& literals = clause.literals;
+            if (literals[0] == falsified) {
+                std::swap(literals[0], literals[1]);
+            }
+            if (value(literals[0]) == 1) {
+                watching[kept++] = index;
+                continue;
+            }
+
+            bool moved = false;
+            for (std::size_t k = 2; k < literals.size(); k++) {
+                if (value(literals[k]) != 0) {
+                    std::swap(literals[1], literals[k]);
+                    watches_[literals[1]].push_back(index);
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) {
+                continue;
+            }
+
+            watching[kept++] = index;
+            if (value(literals[0]) == 0) {
+                for (i++; i < watching.size(); i++) {
+                    watching[kept++] = watching[i];
+                }
+                watching.resize(kept);
+                queue_head_ = trail_.size();
+                return index;
+            }
+            enqueue(literals[0], index);
+        }
+        watching.resize(kept);
+    }
+    return -1;
+}
+
+// first-UIP: resolves the conflict back to the single literal of the current
+// level that every path to the conflict goes through.
+void SatSolver::analyze(int conflict, std::vector<Literal>& learnt, int& backtrack_level)
+{
+    learnt.assign(1, 0);
+    int open = 0;
+    Literal uip = -1;
+    auto index = trail_.size();
+
+    do {
+        const auto& literals = clauses_[conflict].literals;
+        for (std::size_t j = uip < 0 ? 0 : 1; j < literals.size(); j++) {
+            const auto literal = literals[j];
+            const auto var = var_of(literal);
+            if (seen_[var] || level_[var] == 0) {
+                continue;
+            }
+            bump(var);
+            seen_[var] = 1;
+            if (level_[var] >= decision_level()) {
+                open++;
+            } else {
+                learnt.push_back(literal);
+            }
+        }
+        while (!seen_[var_of(trail_[--index])]) {
+        }
+        uip = trail_[index];
+        conflict = reason_[var_of(uip)];
+        seen_[var_of(uip)] = 0;
+        open--;
+    } while (open > 0);
+    learnt[0] = negate(uip);
+
+    backtrack_level = 0;
+    for (std::size_t i = 1; i < learnt.size(); i++) {
+        seen_[var_of(learnt[i])] = 0;
+        if (level_[var_of(learnt[i])] > backtrack_level) {
+            backtrack_level = level_[var_of(learnt[i])];
+            std::swap(learnt[1], learnt[i]);
+        }
+    }
+}
+
+void SatSolver::cancel_until(int level)
+{
+    if (decision_level() <= level) {
+        return;
+    }
+    for (auto i = trail_.size(); i > trail_limits_[level]; i--) {
+        const auto var = var_of(trail_[i - 1]);
+        polarity_[var] = assigns_[var];
+        assigns_[var] = -1;
+        reason_[var] = -1;
+        if (heap_position_[var] < 0) {
+            heap_insert(var);
+        }
+    }
+    trail_.resize(trail_limits_[level]);
+    trail_limits_.resize(level);
+    queue_head_ = trail_.size();
+}
+
+// drops the longer half of the learnt clauses. Only called at the root, where
+// no clause is the reason of anything that analyze() will look at.
+void SatSolver::reduce_learnt()
+{
+    std::vector<int> learnt;
+    for (std::size_t i = 0; i < clauses_.size(); i++) {
+        if (clauses_[i].learnt && !clauses_[i].removed && clauses_[i].literals.size() > 2) {
+            learnt.push_back(static_cast<int>(i));
+        }
+    }
+    std::sort(learnt.begin(), learnt.end(), [this](int a, int b) {
+        return clauses_[a].literals.size() > clauses_[b].literals.size();
+    });
+    for (std::size_t i = 0; i < learnt.size() / 2; i++) {
+        auto& clause = clauses_[learnt[i]];
+        clause.removed = true;
+        std::vector<Literal>().swap(clause.literals);
+        learnt_count_--;
+    }
+}
+
+void SatSolver::bump(int var)
+{
+    activity_[var] += activity_increment_;
+    if (activity_[var] > ACTIVITY_LIMIT) {
+        for (auto& activity : activity_) {
+            activity /= ACTIVITY_LIMIT;
+        }
+        activity_increment_ /= ACTIVITY_LIMIT;
+    }
+    if (heap_position_[var] >= 0) {
+        heap_up(heap_position_[var]);
+    }
+}
+
+void SatSolver::heap_up(int position)
+{
+    const auto var = heap_[position];
+    while (position > 0) {
+        const auto parent = (position - 1) / 2;
+        if (activity_[heap_[parent]] >= activity_[var]) {
+            break;
+        }
+        heap_[position] = heap_[parent];
+        heap_position_[heap_[position]] = position;
+        position = parent;
+    }
+    heap_[position] = var;
+    heap_position_[var] = position;
+}
+
+void SatSolver::heap_down(int position)
+{
+    const auto var = heap_[position];
+    const auto size = static_cast<int>(heap_.size());
+    while (2 * position + 1 < size) {
+        auto child = 2 * position + 1;
+        if (child + 1 < size && activity_[heap_[child + 1]] > activity_[heap_[child]]) {
+            child++;
+        }
+        if (activity_[heap_[child]] <= activity_[var]) {
+            break;
+        }
+        heap_[position] = heap_[child];
+        heap_position_[heap_[position]] = position;
+        position = child;
+    }
+    heap_[position] = var;
+    heap_position_[var] = position;
+}
+
+void SatSolver::heap_insert(int var)
+{
+    heap_.push_back(var);
+    heap_up(static_cast<int>(heap_.size()) - 1);
+}
+
+int SatSolver::heap_pop()
+{
+    const auto top = heap_[0];
+    heap_position_[top] = -1;
+    const auto last = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+        heap_[0] = last;
+        heap_down(0);
+    }
+    return top;
+}
+
+SatSolver::Search SatSolver::search(long long restart_conflicts, const std::vector<Literal>& assumptions, long long& conflicts_left)
+{
+    std::vector<Literal> learnt;
+    long long conflicts = 0;
+    while (true) {
+        const auto conflict = propagate();
+        if (conflict >= 0) {
+            stats_.conflicts++;
+            conflicts++;
+            conflicts_left--;
+            if (decision_level() == 0) {
+                ok_ = false;
+                return Search::Unsat;
+            }
+            int backtrack_level;
+            analyze(conflict, learnt, backtrack_level);
+            cancel_until(backtrack_level);
+            if (learnt.size() == 1) {
+                enqueue(learnt[0], -1);
+            } else {
+                enqueue(learnt[0], attach(learnt, true));
+            }
+            activity_increment_ /= ACTIVITY_DECAY;
+            continue;
+        }
+
+        if (conflicts >= restart_conflicts) {
+            cancel_until(0);
+            return Search::Restart;
+        }
+        if (conflicts_left == 0) {
+            cancel_until(0);
+            return Search::Budget;
+        }
+
+        Literal next = -1;
+        while (decision_level() < static_cast<int>(assumptions.size())) {
+            const auto assumption = assumptions[decision_level()];
+            if (value(assumption) == 1) {
+                // already implied; keep levels aligned with assumptions.
+                trail_limits_.push_back(trail_.size());
+            } else if (value(assumption) == 0) {
+                cancel_until(0);
+                return Search::Unsat;
+            } else {
+                next = assumption;
+                break;
+            }
+        }
+
+        if (next < 0) {
+            while (!heap_.empty() && assigns_[heap_[0]] >= 0) {
+                heap_pop();
+            }
+            if (heap_.empty()) {
+                model_.assign(assigns_.size(), false);
+                for (std::size_t var = 0; var < assigns_.size(); var++) {
+                    model_[var] = assigns_[var] == 1;
+                }
+                cancel_until(0);
+                return Search::Sat;
+            }
+            const auto var = heap_pop();
+            next = polarity_[var] ? positive(var) : negative(var);
+            stats_.decisions++;
+        }
+        trail_limits_.push_back(trail_.size());
+        enqueue(next, -1);
+    }
+}
+
+SatSolver::Result SatSolver::solve(const std::vector<Literal>& assumptions, long long max_conflicts)
+{
+    if (!ok_) {
+        return Result::Unsat;
+    }
+    auto conflicts_left = max_conflicts;
+    for (long long restart = 0;; restart++) {
+        if (learnt_count_ > std::max<int>(2000, static_cast<int>(clauses_.size() - learnt_count_))) {
+            reduce_learnt();
+        }
+        switch (search(luby(restart) * RESTART_BASE, assumptions, conflicts_left)) {
+        case Search::Sat:
+            return Result::Sat;
+        case Search::Unsat:
+            return Result::Unsat;
+        case Search::Budget:
+            return Result::Unknown;
+        case Search::Restart:
+            stats_.restarts++;
+            break;
+        }
+    }
+}
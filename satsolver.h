@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace minesweeper {
+
+// A small conflict-driven clause learning SAT solver.
+// Two watched literals per clause, first-UIP learning, VSIDS branching with
+// phase saving, Luby restarts and periodic removal of long learnt clauses.
+// It is incremental: clauses may be added between calls to solve(), and each
+// call may take assumptions that only hold for that call.
+class SatSolver {
+public:
+    // 2 * var for the positive literal, 2 * var + 1 for the negative one.
+    using Literal = int;
+    static Literal positive(int var) { return 2 * var; }
+    static Literal negative(int var) { return 2 * var + 1; }
+    static Literal negate(Literal literal) { return literal ^ 1; }
+    static int var_of(Literal literal) { return literal >> 1; }
+
+    enum class Result {
+        Sat,
+        Unsat,
+        // max_conflicts ran out first.
+        Unknown
+    };
+
+    struct Stats {
+        long long decisions = 0;
+        long long propagations = 0;
+        long long conflicts = 0;
+        long long restarts = 0;
+        long long learnt = 0;
+    };
+
+private:
+    struct Clause {
+        std::vector<Literal> literals;
+        bool learnt = false;
+        bool removed = false;
+    };
+
+    std::vector<Clause> clauses_;
+    // clauses in which the literal is one of the two watched ones.
+    std::vector<std::vector<int>> watches_;
+    int learnt_count_ = 0;
+
+    // per var: -1 unassigned, 0 false, 1 true.
+    std::vector<std::int8_t> assigns_;
+    std::vector<int> level_;
+    // clause that implied the var, or -1 for decisions and assumptions.
+    std::vector<int> reason_;
+    std::vector<Literal> trail_;
+    std::vector<std::size_t> trail_limits_;
+    std::size_t queue_head_ = 0;
+
+    std::vector<double> activity_;
+    double activity_increment_ = 1.0;
+    std::vector<std::int8_t> polarity_;
+    // binary max-heap of vars by activity, with each var's position or -1.
+    std::vector<int> heap_;
+    std::vector<int> heap_position_;
+
+    std::vector<std::int8_t> seen_;
+    std::vector<bool> model_;
+    bool ok_ = true;
+    Stats stats_;
+
+    int decision_level() const { return static_cast<int>(trail_limits_.size()); }
+    // 1 true, 0 false, -1 unassigned.
+    int value(Literal literal) const
+    {
+        const auto assigned = assigns_[var_of(literal)];
+        return assigned < 0 ? -1 : assigned ^ (literal & 1);
+    }
+
+    void enqueue(Literal literal, int reason);
+    int propagate();
+    void analyze(int conflict, std::vector<Literal>& learnt, int& backtrack_level);
+    void cancel_until(int level);
+    int attach(std::vector<Literal> literals, bool learnt);
+    void reduce_learnt();
+
+    void bump(int var);
+    void heap_up(int position);
+    void heap_down(int position);
+    void heap_insert(int var);
+    int heap_pop();
+
+    enum class Search {
+        Sat,
+        Unsat,
+        Restart,
+        Budget
+    };
+    Search search(long long restart_conflicts, const std::vector<Literal>& assumptions, long long& conflicts_left);
+
+public:
+    int new_var();
+    int vars() const { return static_cast<int>(assigns_.size()); }
+
+    // returns false once the clauses are unsatisfiable on their own.
+    bool add_clause(std::vector<Literal> literals);
+
+    // a negative max_conflicts means no limit.
+    Result solve(const std::vector<Literal>& assumptions = {}, long long max_conflicts = -1);
+
+    // the assignment found by the last solve() that returned Sat.
+    bool model_value(int var) const { return model_[var]; }
+    const Stats& stats() const { return stats_; }
+};
+
+}
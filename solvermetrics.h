@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+namespace minesweeper {
+
+// the stages of MineAI::next_step, which are also the rules cells are
+// resolved by.
+enum class Rule {
+    SingleCell,
+    Pattern,
+    Linear,
+    Enumeration,
+    Sat,
+    Speculation,
+};
+
+constexpr int RULE_COUNT = 6;
+
+inline const char* rule_name(Rule rule)
+{
+    static constexpr std::array<const char*, RULE_COUNT> names = {
+        "single cell", "pattern", "linear", "enumeration", "sat", "speculation"
+    };
+    return names[static_cast<int>(rule)];
+}
+
+// Counters one solver run collects. Everything counts at every nesting
+// level, so speculation includes the work done inside it.
+struct SolverMetrics {
+    // cells resolved by each rule, including resolutions undone by rollback.
+    std::array<long long, RULE_COUNT> deductions {};
+    // wall time spent in each stage; nested stages count towards both.
+    std::array<double, RULE_COUNT> seconds {};
+    // assumptions tried, and how many of them led to a contradiction.
+    long long branches_tried = 0;
+    long long branches_failed = 0;
+    int max_depth = 0;
+    // copies of the solver state, one per parallel branch.
+    long long state_copies = 0;
+    // copies of the board. The solver never copies it; see
+    // LazyInitBoard::generation_metrics() for those made to generate one.
+    long long board_copies = 0;
+
+    long long& deductions_by(Rule rule) { return deductions[static_cast<int>(rule)]; }
+    double& seconds_in(Rule rule) { return seconds[static_cast<int>(rule)]; }
+
+    void merge(const SolverMetrics& other)
+    {
+        for (int i = 0; i < RULE_COUNT; i++) {
+            deductions[i] += other.deductions[i];
+            seconds[i] += other.seconds[i];
+        }
+        branches_tried += other.branches_tried;
+        branches_failed += other.branches_failed;
+        max_depth = std::max(max_depth, other.max_depth);
+        state_copies += other.state_copies;
+        board_copies += other.board_copies;
+    }
+};
+
+// adds the time until it goes out of scope to total.
+class ScopedTimer {
+    double& total_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    explicit ScopedTimer(double& total)
+        : total_(total)
+        , start_(std::chrono::steady_clock::now())
+    {
+    }
+    ~ScopedTimer()
+    {
+        total_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+}
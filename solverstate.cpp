@@ -0,0 +1,168 @@
+#include "solverstate.h"
+#include <stdexcept>
+
+using namespace minesweeper;
+
+SolverState::SolverState(const Board& board)
+    : board_(&board)
+    , safe_(board.get_total_cells())
+    , mine_(board.get_total_cells())
+    , revealed_(board.get_total_cells())
+    , unknown_around_(board.get_total_cells())
+    , mines_around_(board.get_total_cells(), 0)
+    , frontier_(board.get_total_cells())
+    , queued_(board.get_total_cells())
+{
+    const auto cells = board.get_total_cells();
+    for (int i = 0; i < cells; i++) {
+        unknown_around_[i] = static_cast<std::uint8_t>(board.neighbors(i).size());
+    }
+    // the opened plane is all a player gets to see; flags are only guesses.
+    board.opened().for_each([this](int index) {
+        mark_safe(index);
+    });
+    board.opened().for_each([this](int index) {
+        set_revealed(index);
+    });
+}
+
+void SolverState::push_pending(int index)
+{
+    if (!queued_.test(index)) {
+        queued_.set(index);
+        pending_.push_back(index);
+    }
+}
+
+bool SolverState::pop_pending(int& index)
+{
+    if (pending_.empty()) {
+        return false;
+    }
+    index = pending_.back();
+    pending_.pop_back();
+    queued_.reset(index);
+    return true;
+}
+
+void SolverState::set_revealed(int index)
+{
+    revealed_.set(index);
+    if (unknown_around_[index] > 0) {
+        frontier_.set(index);
+        push_pending(index);
+    }
+}
+
+void SolverState::update_neighbors(int index, bool mine, int delta)
+{
+    for (auto next : board_->neighbors(index)) {
+        unknown_around_[next] = static_cast<std::uint8_t>(unknown_around_[next] - delta);
+        if (mine) {
+            mines_around_[next] = static_cast<std::uint8_t>(mines_around_[next] + delta);
+        }
+        if (revealed_.test(next)) {
+            frontier_.assign(next, unknown_around_[next] > 0);
+            if (delta > 0) {
+                push_pending(next);
+            }
+        }
+    }
+}
+
+void SolverState::mark_safe(int index)
+{
+    if (!is_unknown(index)) {
+        return;
+    }
+    if (depth_ > 0) {
+        trail_.push_back({ index, false });
+    }
+    safe_.set(index);
+    safe_count_++;
+    update_neighbors(index, false, 1);
+}
+
+void SolverState::mark_mine(int index)
+{
+    if (!is_unknown(index)) {
+        return;
+    }
+    if (depth_ > 0) {
+        trail_.push_back({ index, true });
+    }
+    mine_.set(index);
+    mine_count_++;
+    update_neighbors(index, true, 1);
+}
+
+void SolverState::reveal(int index)
+{
+    if (depth_ > 0) {
+        throw std::logic_error("cannot reveal a cell while speculating");
+    }
+    if (board_->has_bomb(index)) {
+        throw std::logic_error("solver revealed a bomb");
+    }
+    mark_safe(index);
+    if (!revealed_.test(index)) {
+        set_revealed(index);
+    }
+}
+
+void SolverState::sync_opened(const std::vector<int>& cells)
+{
+    for (auto index : cells) {
+        mark_safe(index);
+    }
+    for (auto index : cells) {
+        if (!revealed_.test(index)) {
+            set_revealed(index);
+        }
+    }
+}
+
+void SolverState::mine_moved(int index)
+{
+    if (depth_ > 0) {
+        throw std::logic_error("cannot move a mine while speculating");
+    }
+    for (auto next : board_->neighbors(index)) {
+        if (revealed_.test(next)) {
+            push_pending(next);
+        }
+    }
+}
+
+SolverState::Checkpoint SolverState::checkpoint()
+{
+    depth_++;
+    saved_pending_.push_back(pending_);
+    return trail_.size();
+}
+
+void SolverState::rollback(Checkpoint checkpoint)
+{
+    for (auto i = trail_.size(); i > checkpoint; i--) {
+        const auto& entry = trail_[i - 1];
+        if (entry.mine) {
+            mine_.reset(entry.index);
+            mine_count_--;
+        } else {
+            safe_.reset(entry.index);
+            safe_count_--;
+        }
+        update_neighbors(entry.index, entry.mine, -1);
+    }
+    trail_.resize(checkpoint);
+
+    for (auto index : pending_) {
+        queued_.reset(index);
+    }
+    pending_ = std::move(saved_pending_.back());
+    saved_pending_.pop_back();
+    for (auto index : pending_) {
+        queued_.set(index);
+    }
+    depth_--;
+}
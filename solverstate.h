@@ -0,0 +1,106 @@
+#pragma once
+
+#include "bitplane.h"
+#include "board.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace minesweeper {
+
+// What a solver knows about a board, kept apart from the Board itself.
+// The only things read from the board are what a player can see: which
+// cells are opened and their numbers. Everything else is the solver's own
+// deduction, or speculation between checkpoint() and rollback().
+// The board is never modified, so several solvers may share one board.
+class SolverState {
+public:
+    using Checkpoint = std::size_t;
+
+private:
+    const Board* board_;
+    BitPlane safe_;
+    BitPlane mine_;
+    // safe cells whose number is visible. Only grows outside speculation.
+    BitPlane revealed_;
+    int safe_count_ = 0;
+    int mine_count_ = 0;
+
+    // per cell: neighbors not yet known, and neighbors known to be mines.
+    std::vector<std::uint8_t> unknown_around_;
+    std::vector<std::uint8_t> mines_around_;
+    // revealed cells that still have unknown neighbors.
+    BitPlane frontier_;
+
+    // revealed cells whose neighborhood changed since they were last looked at.
+    std::vector<int> pending_;
+    BitPlane queued_;
+
+    struct TrailEntry {
+        int index;
+        bool mine;
+    };
+    std::vector<TrailEntry> trail_;
+    // pending_ as it was at each open checkpoint.
+    std::vector<std::vector<int>> saved_pending_;
+    int depth_ = 0;
+
+    void push_pending(int index);
+    void set_revealed(int index);
+    void update_neighbors(int index, bool mine, int delta);
+
+public:
+    explicit SolverState(const Board& board);
+
+    const Board& board() const { return *board_; }
+    int total_cells() const { return board_->get_total_cells(); }
+    int total_mines() const { return board_->init_bombs(); }
+
+    bool is_safe(int index) const { return safe_.test(index); }
+    bool is_mine(int index) const { return mine_.test(index); }
+    bool is_unknown(int index) const { return !safe_.test(index) && !mine_.test(index); }
+    bool is_revealed(int index) const { return revealed_.test(index); }
+
+    // only meaningful for revealed cells.
+    int number(int index) const { return board_->neighbor_bombs(index); }
+
+    const BitPlane& safe() const { return safe_; }
+    const BitPlane& mine() const { return mine_; }
+    const BitPlane& revealed() const { return revealed_; }
+
+    int safe_count() const { return safe_count_; }
+    int mine_count() const { return mine_count_; }
+
+    int unknown_around(int index) const { return unknown_around_[index]; }
+    int mines_around(int index) const { return mines_around_[index]; }
+    const BitPlane& frontier() const { return frontier_; }
+
+    // takes the next revealed cell whose constraint may allow a new deduction.
+    // Cells are queued again whenever one of their neighbors becomes known.
+    bool pop_pending(int& index);
+
+    // every safe cell is known.
+    bool solved() const { return safe_count_ == total_cells() - total_mines(); }
+    // the known cells do not exceed the global mine count.
+    bool consistent() const { return mine_count_ <= total_mines() && safe_count_ <= total_cells() - total_mines(); }
+
+    void mark_safe(int index);
+    void mark_mine(int index);
+
+    // looks at the number of a known safe cell, as a player clicking it would.
+    // Not allowed while speculating.
+    void reveal(int index);
+    // picks up cells that were opened on the board, e.g. Board::last_revealed().
+    void sync_opened(const std::vector<int>& cells);
+    // the board put a mine into or took one out of the unknown cell index,
+    // so the numbers around it changed. What is known stays true.
+    void mine_moved(int index);
+
+    // While at least one checkpoint is open, marks are logged so that
+    // rollback() undoes everything since the checkpoint in O(changes).
+    bool speculating() const { return depth_ > 0; }
+    Checkpoint checkpoint();
+    void rollback(Checkpoint checkpoint);
+};
+
+}
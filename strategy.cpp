@@ -0,0 +1,162 @@
+#include "strategy.h"
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <utility>
+
+using namespace minesweeper;
+
+namespace {
+
+struct CountingCallback : public AICallback {
+    AICallback& inner;
+    int steps = 0;
+
+    explicit CountingCallback(AICallback& inner)
+        : inner(inner)
+    {
+    }
+    void before_start(const SolverState& state) override { inner.before_start(state); }
+    bool on_step(const SolverState& state, int current_step, int nest_level) override
+    {
+        if (nest_level == 0) {
+            steps++;
+        }
+        return inner.on_step(state, current_step, nest_level);
+    }
+    void on_finish(const SolverState& state, const SolverMetrics& metrics) override { inner.on_finish(state, metrics); }
+    bool cancelled() const override { return inner.cancelled(); }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::map<std::string, StrategyRegistry::Factory> factories;
+    std::string default_name = "speculative";
+
+    Registry()
+    {
+        const auto add = [this](const std::string& name, unsigned stages, MineAI::Backend backend) {
+            factories[name] = [name, stages, backend] {
+                return std::make_unique<MineAIStrategy>(name, stages, backend);
+            };
+        };
+        add("propagation", 0, MineAI::Backend::Speculation);
+        add("patterns", MineAI::PATTERNS, MineAI::Backend::Speculation);
+        add("linear", MineAI::PATTERNS | MineAI::LINEAR, MineAI::Backend::Speculation);
+        add("enumeration", MineAI::PATTERNS | MineAI::LINEAR | MineAI::ENUMERATION, MineAI::Backend::Speculation);
+        add("sat", MineAI::PATTERNS | MineAI::LINEAR, MineAI::Backend::Sat);
+        add("speculative", MineAI::ALL_STAGES, MineAI::Backend::Speculation);
+
+        if (const auto* name = std::getenv("LOGICALSWEEPER_SOLVER")) {
+            if (factories.count(name) > 0) {
+                default_name = name;
+            }
+        }
+    }
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+}
+
+MineAIStrategy::MineAIStrategy(std::string name, unsigned stages, MineAI::Backend backend, int max_nest)
+    : name_(std::move(name))
+    , stages_(stages)
+    , backend_(backend)
+    , max_nest_(max_nest)
+{
+}
+
+void MineAIStrategy::configure(MineAI& ai) const
+{
+    ai.stages() = stages_;
+    ai.backend() = backend_;
+    ai.max_nest() = max_nest_;
+    ai.parallel_branches() = parallel_;
+}
+
+SolveStats MineAIStrategy::run(MineAI& ai, AICallback& cb) const
+{
+    configure(ai);
+
+    CountingCallback counting(cb);
+    const auto start = std::chrono::steady_clock::now();
+    SolveStats stats;
+    stats.strategy = name_;
+    stats.result = ai.run(counting);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.steps = counting.steps;
+    stats.safe = ai.knowledge().safe_count();
+    stats.mines = ai.knowledge().mine_count();
+    stats.metrics = ai.metrics();
+    return stats;
+}
+
+SolveStats MineAIStrategy::solve(const Board& board, AICallback& cb) const
+{
+    MineAI ai(board);
+    return run(ai, cb);
+}
+
+SolveStats MineAIStrategy::play(Board& board, AICallback& cb) const
+{
+    auto ai = MineAI::player(board);
+    ai.per_step_callbacks() = true;
+    return run(ai, cb);
+}
+
+void StrategyRegistry::add(const std::string& name, Factory factory)
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.factories[name] = std::move(factory);
+}
+
+std::unique_ptr<SolverStrategy> StrategyRegistry::create(const std::string& name)
+{
+    auto& r = registry();
+    Factory factory;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        const auto found = r.factories.find(name);
+        if (found == r.factories.end()) {
+            return nullptr;
+        }
+        factory = found->second;
+    }
+    return factory();
+}
+
+std::vector<std::string> StrategyRegistry::names()
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<std::string> result;
+    for (const auto& entry : r.factories) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+std::string StrategyRegistry::default_name()
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.default_name;
+}
+
+bool StrategyRegistry::set_default(const std::string& name)
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.factories.count(name) == 0) {
+        return false;
+    }
+    r.default_name = name;
+    return true;
+}
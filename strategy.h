@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ai.h"
+#include "board.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace minesweeper {
+
+// A way of proving cells on a board, picked by name at runtime.
+class SolverStrategy {
+public:
+    virtual ~SolverStrategy() = default;
+
+    virtual const std::string& name() const = 0;
+    // proves what it can without touching board.
+    virtual SolveStats solve(const Board& board, AICallback& cb) const = 0;
+    // also opens and flags the cells it proves on board, calling cb after
+    // every single move so that it can be shown.
+    virtual SolveStats play(Board& board, AICallback& cb) const = 0;
+};
+
+// MineAI with a fixed set of stages and backend.
+class MineAIStrategy : public SolverStrategy {
+    std::string name_;
+    unsigned stages_;
+    MineAI::Backend backend_;
+    int max_nest_;
+    bool parallel_ = true;
+
+    SolveStats run(MineAI& ai, AICallback& cb) const;
+
+public:
+    MineAIStrategy(std::string name, unsigned stages,
+        MineAI::Backend backend = MineAI::Backend::Speculation, int max_nest = 1);
+
+    // sets up ai the way solve() and play() do.
+    void configure(MineAI& ai) const;
+
+    // see MineAI::parallel_branches().
+    bool& parallel_branches() { return parallel_; }
+    const bool& parallel_branches() const { return parallel_; }
+
+    const std::string& name() const override { return name_; }
+    SolveStats solve(const Board& board, AICallback& cb) const override;
+    SolveStats play(Board& board, AICallback& cb) const override;
+};
+
+// Named strategy factories, safe to use from any thread.
+// Built in, from cheapest to strongest:
+//   propagation   the single-cell rule only
+//   patterns      and the two-number pattern table
+//   linear        and row reduction with the mine count
+//   enumeration   and exact component enumeration, no assumptions
+//   sat           the SAT backend in place of enumeration and assumptions
+//   speculative   every stage and one level of assumptions
+// The default is speculative, or LOGICALSWEEPER_SOLVER from the environment
+// if that names a strategy.
+class StrategyRegistry {
+public:
+    using Factory = std::function<std::unique_ptr<SolverStrategy>()>;
+
+    // replaces any strategy of the same name.
+    static void add(const std::string& name, Factory factory);
+    // nullptr if no strategy has that name.
+    static std::unique_ptr<SolverStrategy> create(const std::string& name);
+    static std::vector<std::string> names();
+
+    static std::string default_name();
+    // returns false, changing nothing, if no strategy has that name.
+    static bool set_default(const std::string& name);
+};
+
+}
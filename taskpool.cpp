@@ -0,0 +1,174 @@
+#include "taskpool.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+using namespace minesweeper;
+
+namespace {
+
+// the pool and deque the current thread works on, if it is a worker.
+thread_local const TaskPool* current_pool = nullptr;
+thread_local unsigned current_queue = 0;
+
+}
+
+TaskPool::TaskPool(unsigned workers)
+{
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < workers; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < workers; i++) {
+        threads_.emplace_back([this, i] { work(i); });
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+TaskPool& TaskPool::shared()
+{
+    static TaskPool pool;
+    return pool;
+}
+
+void TaskPool::submit(Task task, const void* owner)
+{
+    const auto target = current_pool == this
+        ? current_queue
+        : next_queue_++ % static_cast<unsigned>(queues_.size());
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back({ std::move(task), owner });
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        queued_++;
+    }
+    wake_.notify_one();
+}
+
+bool TaskPool::take(unsigned self, Task& task, const void* owner)
+{
+    const auto count = static_cast<unsigned>(queues_.size());
+    const auto matches = [owner](const Entry& entry) { return owner == nullptr || entry.owner == owner; };
+    for (unsigned k = 0; k < count; k++) {
+        auto& queue = *queues_[(self + k) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        // newest of our own, oldest of anyone else's.
+        auto found = queue.tasks.end();
+        if (k == 0) {
+            const auto last = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), matches);
+            if (last != queue.tasks.rend()) {
+                found = std::prev(last.base());
+            }
+        } else {
+            found = std::find_if(queue.tasks.begin(), queue.tasks.end(), matches);
+        }
+        if (found == queue.tasks.end()) {
+            continue;
+        }
+        task = std::move(found->task);
+        queue.tasks.erase(found);
+        std::lock_guard<std::mutex> wake_lock(wake_mutex_);
+        queued_--;
+        return true;
+    }
+    return false;
+}
+
+bool TaskPool::run_one(const void* owner)
+{
+    Task task;
+    const auto self = current_pool == this ? current_queue : 0;
+    if (!take(self, task, owner)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void TaskPool::work(unsigned self)
+{
+    current_pool = this;
+    current_queue = self;
+    while (true) {
+        Task task;
+        if (take(self, task, nullptr)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+void TaskGroup::run(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_++;
+    }
+    pool_.submit([this, task = std::move(task)] {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            cancelled_ = true;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) {
+            done_.notify_all();
+        }
+    },
+        this);
+}
+
+void TaskGroup::wait()
+{
+    join();
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(error, error_);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGroup::join()
+{
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_ == 0) {
+                return;
+            }
+        }
+        if (!pool_.run_one(this)) {
+            // the rest are running elsewhere.
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return pending_ == 0; });
+            return;
+        }
+    }
+}
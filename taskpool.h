@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace minesweeper {
+
+// A fixed set of worker threads, each with its own deque of tasks.
+// A worker runs tasks from the back of its own deque and steals from the
+// front of the others' when it runs dry. Tasks submitted from a worker go to
+// that worker's deque; others are spread round-robin.
+class TaskPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Entry {
+        Task task;
+        // whoever submitted it, so that they can help with their own tasks.
+        const void* owner;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Entry> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    int queued_ = 0;
+    bool stopping_ = false;
+    std::atomic<unsigned> next_queue_ { 0 };
+
+    // any task if owner is nullptr, otherwise only the owner's.
+    bool take(unsigned self, Task& task, const void* owner);
+    void work(unsigned self);
+
+public:
+    // 0 means one worker per hardware thread.
+    explicit TaskPool(unsigned workers = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+    void submit(Task task, const void* owner = nullptr);
+    // runs one queued task of owner on the calling thread, if there is any;
+    // with nullptr, any queued task.
+    bool run_one(const void* owner = nullptr);
+
+    // the pool the solvers use.
+    static TaskPool& shared();
+};
+
+// Tasks submitted together and waited for together.
+// cancel() only sets a flag; tasks are expected to check cancelled() and
+// return early. A task that throws cancels the group, and wait() rethrows
+// the first such exception.
+class TaskGroup {
+    TaskPool& pool_;
+    std::atomic<bool> cancelled_ { false };
+    std::mutex mutex_;
+    std::condition_variable done_;
+    int pending_ = 0;
+    std::exception_ptr error_;
+
+    void join();
+
+public:
+    explicit TaskGroup(TaskPool& pool = TaskPool::shared())
+        : pool_(pool)
+    {
+    }
+    ~TaskGroup() { join(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+
+    void cancel() { cancelled_ = true; }
+    bool cancelled() const { return cancelled_; }
+
+    // helps with the group's own queued tasks until every task of it has
+    // finished, so waiting from inside a worker cannot starve the pool, and
+    // unrelated long tasks never end up on the waiting thread.
+    void wait();
+};
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace minesweeper {
+
+enum class TraceKind : std::uint8_t {
+    // value: the rule, cell: -1, depth: nest level.
+    PhaseBegin,
+    PhaseEnd,
+    // cell resolved; value: 1 for a mine, 0 for safe.
+    Deduction,
+    // value: 1 if the cell is assumed to be a mine.
+    AssumeBegin,
+    // value: 1 if the assumption led to a contradiction.
+    AssumeEnd,
+};
+
+struct TraceEvent {
+    std::uint64_t nanoseconds;
+    TraceKind kind;
+    std::uint8_t depth;
+    std::int16_t value;
+    std::int32_t cell;
+};
+
+// Fixed-size ring of the most recent trace events, written without locks
+// from any number of threads. Each slot carries a sequence number that is odd
+// while the slot is being written, so snapshot() skips slots that are torn.
+// Events are only recorded when LOGICALSWEEPER_TRACE is defined; otherwise
+// SOLVER_TRACE expands to nothing.
+class TraceRing {
+public:
+    static constexpr std::size_t CAPACITY = 1 << 16;
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> sequence { 0 };
+        std::atomic<std::uint64_t> time { 0 };
+        std::atomic<std::uint64_t> payload { 0 };
+    };
+
+    std::array<Slot, CAPACITY> slots_;
+    std::atomic<std::uint64_t> head_ { 0 };
+
+public:
+    void push(TraceKind kind, int cell, int depth, int value)
+    {
+        const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+                              .count();
+        const auto payload = static_cast<std::uint64_t>(static_cast<std::uint8_t>(kind))
+            | static_cast<std::uint64_t>(static_cast<std::uint8_t>(depth)) << 8
+            | static_cast<std::uint64_t>(static_cast<std::uint16_t>(value)) << 16
+            | static_cast<std::uint64_t>(static_cast<std::uint32_t>(cell)) << 32;
+
+        const auto index = head_.fetch_add(1, std::memory_order_relaxed);
+        auto& slot = slots_[index % CAPACITY];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.time.store(static_cast<std::uint64_t>(time), std::memory_order_relaxed);
+        slot.payload.store(payload, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+    }
+
+    // the events still in the ring, oldest first.
+    std::vector<TraceEvent> snapshot() const
+    {
+        std::vector<TraceEvent> events;
+        const auto head = head_.load(std::memory_order_acquire);
+        const auto first = head > CAPACITY ? head - CAPACITY : 0;
+        for (auto index = first; index < head; index++) {
+            const auto& slot = slots_[index % CAPACITY];
+            const auto before = slot.sequence.load(std::memory_order_acquire);
+            const auto time = slot.time.load(std::memory_order_relaxed);
+            const auto payload = slot.payload.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (before != 2 * index + 2 || slot.sequence.load(std::memory_order_relaxed) != before) {
+                continue;
+            }
+            events.push_back({ time,
+                static_cast<TraceKind>(payload & 0xff),
+                static_cast<std::uint8_t>((payload >> 8) & 0xff),
+                static_cast<std::int16_t>((payload >> 16) & 0xffff),
+                static_cast<std::int32_t>(payload >> 32) });
+        }
+        return events;
+    }
+
+    void clear() { head_.store(0, std::memory_order_relaxed); }
+
+    static TraceRing& global()
+    {
+        static TraceRing ring;
+        return ring;
+    }
+};
+
+}
+
+#ifdef LOGICALSWEEPER_TRACE
+#define SOLVER_TRACE(kind, cell, depth, value) \
+    ::minesweeper::TraceRing::global().push(::minesweeper::TraceKind::kind, (cell), (depth), (value))
+#else
+#define SOLVER_TRACE(kind, cell, depth, value) ((void)0)
+#endif